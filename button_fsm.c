@@ -0,0 +1,170 @@
+#include "button_fsm.h"
+
+#include <stddef.h>
+
+/**
+ * @brief Проверка наступления срока с учетом переполнения счетчика
+ */
+static bool button_fsm_due(uint32_t now, uint32_t deadline)
+{
+    return (int32_t)(now - deadline) >= 0;
+}
+
+static void button_fsm_emit(button_fsm_t *fsm, button_fsm_event event)
+{
+    if (fsm->handler)
+    {
+        fsm->handler(fsm, event);
+    }
+}
+
+/**
+ * @brief Выбор более раннего срока
+ */
+static void button_fsm_earliest(bool *found, uint32_t *deadline, uint32_t candidate)
+{
+    if (!*found || (int32_t)(candidate - *deadline) < 0)
+    {
+        *deadline = candidate;
+        *found = true;
+    }
+}
+
+void button_fsm_init(button_fsm_t *fsm, const button_fsm_config_t *config, button_fsm_handler handler)
+{
+    fsm->config = *config;
+    fsm->handler = handler;
+
+    fsm->pressed = false;
+    fsm->debounce_pending = false;
+    fsm->long_press_active = false;
+    fsm->click_counter = 0;
+}
+
+void button_fsm_edge(button_fsm_t *fsm, uint32_t now)
+{
+    // Каждый фронт отодвигает окончание антидребезга
+    if (!fsm->debounce_pending)
+    {
+        fsm->burst_ticks = now;
+    }
+    fsm->edge_ticks = now;
+    fsm->debounce_pending = true;
+}
+
+void button_fsm_settled(button_fsm_t *fsm, uint32_t now, bool pressed)
+{
+    button_fsm_edge(fsm, now - fsm->config.debounce_ticks);
+    button_fsm_process(fsm, now, pressed);
+}
+
+void button_fsm_process(button_fsm_t *fsm, uint32_t now, bool pressed)
+{
+    if (fsm->debounce_pending && button_fsm_due(now, fsm->edge_ticks + fsm->config.debounce_ticks))
+    {
+        fsm->debounce_pending = false;
+
+        if (pressed && !fsm->pressed)
+        {
+            fsm->pressed = true;
+            fsm->press_ticks = now;
+            fsm->click_ticks = now;
+            if (fsm->click_counter < UINT8_MAX)
+            {
+                fsm->click_counter++;
+            }
+            button_fsm_emit(fsm, BUTTON_FSM_EVT_PRESS);
+        }
+        else if (!pressed && fsm->pressed)
+        {
+            fsm->pressed = false;
+            fsm->long_press_active = false;
+            button_fsm_emit(fsm, BUTTON_FSM_EVT_RELEASE);
+        }
+    }
+
+    // Серия кликов завершается только после отпускания, иначе долгое нажатие
+    // разорвало бы серию посередине
+    if (fsm->click_counter > 0 && !fsm->pressed &&
+        button_fsm_due(now, fsm->click_ticks + fsm->config.double_click_ticks))
+    {
+        button_fsm_emit(fsm, BUTTON_FSM_EVT_CLICK_TIMEOUT);
+        fsm->click_counter = 0;
+    }
+
+    if (!fsm->pressed)
+    {
+        return;
+    }
+
+    if (!fsm->long_press_active)
+    {
+        if (button_fsm_due(now, fsm->press_ticks + fsm->config.long_press_ticks))
+        {
+            fsm->long_press_active = true;
+            fsm->repeat_ticks = now + fsm->config.repeat_ticks;
+            button_fsm_emit(fsm, BUTTON_FSM_EVT_LONG_PRESS);
+        }
+    }
+    else if (button_fsm_due(now, fsm->repeat_ticks))
+    {
+        // Повтор держит фазу, но после долгой задержки не догоняет пропущенные шаги
+        fsm->repeat_ticks += fsm->config.repeat_ticks;
+        if (button_fsm_due(now, fsm->repeat_ticks))
+        {
+            fsm->repeat_ticks = now + fsm->config.repeat_ticks;
+        }
+        button_fsm_emit(fsm, BUTTON_FSM_EVT_LONG_REPEAT);
+    }
+}
+
+bool button_fsm_next_deadline(const button_fsm_t *fsm, uint32_t *deadline)
+{
+    bool found = false;
+
+    if (fsm->debounce_pending)
+    {
+        button_fsm_earliest(&found, deadline, fsm->edge_ticks + fsm->config.debounce_ticks);
+    }
+
+    if (fsm->click_counter > 0 && !fsm->pressed)
+    {
+        button_fsm_earliest(&found, deadline, fsm->click_ticks + fsm->config.double_click_ticks);
+    }
+
+    if (fsm->pressed)
+    {
+        button_fsm_earliest(&found, deadline, fsm->long_press_active ? fsm->repeat_ticks : fsm->press_ticks + fsm->config.long_press_ticks);
+    }
+
+    return found;
+}
+
+button_fsm_timer_action button_fsm_schedule(button_fsm_timer_t *timer, const button_fsm_t *fsm,
+                                            uint32_t now, uint32_t min_timeout, uint32_t *timeout)
+{
+    uint32_t deadline;
+
+    if (!button_fsm_next_deadline(fsm, &deadline))
+    {
+        return BUTTON_FSM_TIMER_KEEP;
+    }
+
+    if (timer->scheduled && (int32_t)(timer->deadline - deadline) <= 0)
+    {
+        return BUTTON_FSM_TIMER_KEEP;
+    }
+
+    int32_t delay = (int32_t)(deadline - now);
+    *timeout = delay < (int32_t)min_timeout ? min_timeout : (uint32_t)delay;
+
+    button_fsm_timer_action action = timer->scheduled ? BUTTON_FSM_TIMER_RESTART : BUTTON_FSM_TIMER_START;
+    timer->scheduled = true;
+    timer->deadline = deadline;
+    return action;
+}
+
+void button_fsm_timer_expired(button_fsm_timer_t *timer)
+{
+    timer->scheduled = false;
+}
@@ -0,0 +1,128 @@
+#ifndef BUTTON_FSM_H
+#define BUTTON_FSM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Автомат состояний кнопки на метках времени
+ *
+ * Не зависит от периферии: получает метки времени фронтов и текущий уровень,
+ * сообщает о событиях и о ближайшем моменте, когда его нужно вызвать снова.
+ * Время - монотонный 32-битный счетчик тиков, сравнения учитывают переполнение.
+ */
+
+typedef enum
+{
+    BUTTON_FSM_EVT_PRESS,
+    BUTTON_FSM_EVT_RELEASE,
+    BUTTON_FSM_EVT_LONG_PRESS,
+    BUTTON_FSM_EVT_LONG_REPEAT,
+    BUTTON_FSM_EVT_CLICK_TIMEOUT
+} button_fsm_event;
+
+typedef enum
+{
+    BUTTON_FSM_TIMER_KEEP,
+    BUTTON_FSM_TIMER_START,
+    BUTTON_FSM_TIMER_RESTART
+} button_fsm_timer_action;
+
+/** Единственный таймер, общий для всех автоматов */
+typedef struct
+{
+    bool scheduled;
+    uint32_t deadline;
+} button_fsm_timer_t;
+
+typedef struct button_fsm_s button_fsm_t;
+
+typedef void (*button_fsm_handler)(button_fsm_t *fsm, button_fsm_event event);
+
+typedef struct
+{
+    uint32_t debounce_ticks;
+    uint32_t double_click_ticks;
+    uint32_t long_press_ticks;
+    uint32_t repeat_ticks;
+} button_fsm_config_t;
+
+struct button_fsm_s
+{
+    button_fsm_config_t config;
+    button_fsm_handler handler;
+
+    bool pressed;
+    bool debounce_pending;
+    bool long_press_active;
+    uint8_t click_counter;
+
+    uint32_t edge_ticks;
+    // Первый фронт последней серии дребезга: момент физического нажатия для
+    // события BUTTON_FSM_EVT_PRESS
+    uint32_t burst_ticks;
+    uint32_t press_ticks;
+    uint32_t click_ticks;
+    uint32_t repeat_ticks;
+};
+
+/**
+ * @brief Инициализация автомата
+ * @param fsm     Автомат
+ * @param config  Интервалы в тиках
+ * @param handler Обработчик событий
+ */
+void button_fsm_init(button_fsm_t *fsm, const button_fsm_config_t *config, button_fsm_handler handler);
+
+/**
+ * @brief Регистрация фронта (любого направления)
+ * @param now Метка времени фронта
+ */
+void button_fsm_edge(button_fsm_t *fsm, uint32_t now);
+
+/**
+ * @brief Уровень, уже прошедший антидребезг вне автомата (аппаратно)
+ *
+ * Последний фронт считается случившимся ровно за интервал антидребезга до now.
+ * @param now     Текущая метка времени
+ * @param pressed Текущий уровень кнопки
+ */
+void button_fsm_settled(button_fsm_t *fsm, uint32_t now, bool pressed);
+
+/**
+ * @brief Обработка наступивших сроков
+ * @param now     Текущее время
+ * @param pressed Текущий уровень кнопки
+ */
+void button_fsm_process(button_fsm_t *fsm, uint32_t now, bool pressed);
+
+/**
+ * @brief Ближайший срок, к которому нужно вызвать button_fsm_process()
+ * @param deadline Найденный срок
+ * @return false если автомат ничего не ждет
+ */
+bool button_fsm_next_deadline(const button_fsm_t *fsm, uint32_t *deadline);
+
+/**
+ * @brief Учет срока одного автомата в общем таймере
+ *
+ * Таймер перезапускается только если срок автомата раньше уже
+ * запланированного, поэтому после фронта достаточно проверить один автомат:
+ * дребезг лишь отодвигает срок антидребезга, и серия фронтов не трогает
+ * таймер, а раннее срабатывание просто планирует автоматы заново.
+ * @param timer       Общий таймер
+ * @param fsm         Автомат, срок которого изменился
+ * @param now         Текущее время
+ * @param min_timeout Минимальный интервал таймера в тиках
+ * @param timeout     Интервал для BUTTON_FSM_TIMER_START и BUTTON_FSM_TIMER_RESTART
+ * @return Действие, которое нужно выполнить с таймером
+ */
+button_fsm_timer_action button_fsm_schedule(button_fsm_timer_t *timer, const button_fsm_t *fsm,
+                                            uint32_t now, uint32_t min_timeout, uint32_t *timeout);
+
+/**
+ * @brief Отметка срабатывания общего таймера
+ */
+void button_fsm_timer_expired(button_fsm_timer_t *timer);
+
+#endif // BUTTON_FSM_H
@@ -0,0 +1,124 @@
+#include "button_gesture.h"
+
+#include <stddef.h>
+
+static void gesture_fire(gesture_engine_t *engine, uint8_t index)
+{
+    const gesture_pattern *pattern = &engine->patterns[index];
+
+    engine->acted |= 1UL << index;
+    if (pattern->action)
+    {
+        pattern->action();
+    }
+}
+
+void gesture_init(gesture_engine_t *engine, const gesture_pattern *patterns, uint8_t count, uint32_t tick_freq)
+{
+    engine->patterns = patterns;
+    engine->count = count > GESTURE_MAX_PATTERNS ? GESTURE_MAX_PATTERNS : count;
+    engine->tick_freq = tick_freq;
+
+    engine->presses = 0;
+    engine->pressed = false;
+    engine->held = false;
+    engine->fired = 0;
+    engine->acted = 0;
+}
+
+uint32_t gesture_hold_ms(const gesture_engine_t *engine, uint32_t ticks)
+{
+    if (!engine->pressed)
+    {
+        return 0;
+    }
+
+    return (uint32_t)((uint64_t)(ticks - engine->press_ticks) * 1000 / engine->tick_freq);
+}
+
+uint32_t gesture_process(gesture_engine_t *engine, button_fsm_event event, uint32_t ticks)
+{
+    uint32_t recognized = 0;
+
+    engine->acted = 0;
+    switch (event)
+    {
+    case BUTTON_FSM_EVT_PRESS:
+        if (engine->presses < UINT8_MAX)
+        {
+            engine->presses++;
+        }
+        engine->pressed = true;
+        engine->press_ticks = ticks;
+        engine->fired = 0;
+
+        for (uint8_t i = 0; i < engine->count; ++i)
+        {
+            const gesture_pattern *pattern = &engine->patterns[i];
+            if (pattern->hold_ms == 0 && (pattern->flags & GESTURE_FLAG_IMMEDIATE) &&
+                (pattern->presses == engine->presses || pattern->presses == 0))
+            {
+                recognized |= 1UL << i;
+                gesture_fire(engine, i);
+            }
+        }
+        break;
+
+    case BUTTON_FSM_EVT_LONG_PRESS:
+    case BUTTON_FSM_EVT_LONG_REPEAT:
+    {
+        uint32_t hold_ms = gesture_hold_ms(engine, ticks);
+
+        for (uint8_t i = 0; i < engine->count; ++i)
+        {
+            const gesture_pattern *pattern = &engine->patterns[i];
+            if (pattern->hold_ms == 0 || pattern->presses != engine->presses || hold_ms < pattern->hold_ms)
+            {
+                continue;
+            }
+
+            if (!(engine->fired & (1UL << i)))
+            {
+                engine->fired |= 1UL << i;
+                engine->held = true;
+                recognized |= 1UL << i;
+                gesture_fire(engine, i);
+            }
+            else if (pattern->flags & GESTURE_FLAG_REPEAT)
+            {
+                gesture_fire(engine, i);
+            }
+        }
+        break;
+    }
+
+    case BUTTON_FSM_EVT_RELEASE:
+        engine->pressed = false;
+        if (engine->held)
+        {
+            // Удержание завершает серию, последующее окончание окна кликов игнорируется
+            engine->held = false;
+            engine->presses = 0;
+        }
+        break;
+
+    case BUTTON_FSM_EVT_CLICK_TIMEOUT:
+        for (uint8_t i = 0; i < engine->count; ++i)
+        {
+            const gesture_pattern *pattern = &engine->patterns[i];
+            if (pattern->hold_ms == 0 && !(pattern->flags & GESTURE_FLAG_IMMEDIATE) &&
+                pattern->presses == engine->presses)
+            {
+                recognized |= 1UL << i;
+                gesture_fire(engine, i);
+            }
+        }
+        engine->presses = 0;
+        break;
+
+    default:
+        break;
+    }
+
+    return recognized;
+}
@@ -0,0 +1,79 @@
+#ifndef BUTTON_GESTURE_H
+#define BUTTON_GESTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "button_fsm.h"
+
+/**
+ * @brief Распознавание жестов по таблице шаблонов
+ *
+ * Шаблон - серия из presses нажатий; если hold_ms > 0, последнее нажатие
+ * должно удерживаться не меньше hold_ms. Примеры:
+ *   {1, 0}    - одиночный клик,     {3, 0}    - тройной клик,
+ *   {1, 1000} - долгое нажатие,     {2, 1000} - клик и удержание,
+ *   {1, 5000} - удержание 5 секунд.
+ * presses = 0 с флагом GESTURE_FLAG_IMMEDIATE срабатывает на каждом нажатии.
+ * Каждое событие автомата кнопки проверяется по всем шаблонам за O(шаблонов),
+ * удержание проверяется на тиках повтора долгого нажатия, поэтому новые
+ * жесты не требуют таймеров. Удержание короче задержки долгого нажатия
+ * автомата срабатывает вместе с ним.
+ */
+
+/** Срабатывание на нажатии, без ожидания окончания серии */
+#define GESTURE_FLAG_IMMEDIATE (1 << 0)
+/** Повтор действия на каждом тике удержания */
+#define GESTURE_FLAG_REPEAT (1 << 1)
+
+#define GESTURE_MAX_PATTERNS 32
+
+typedef void (*gesture_action)(void);
+
+typedef struct
+{
+    uint8_t presses;
+    uint8_t flags;
+    uint16_t hold_ms;
+    gesture_action action;
+} gesture_pattern;
+
+typedef struct
+{
+    const gesture_pattern *patterns;
+    uint8_t count;
+    uint32_t tick_freq;
+
+    uint8_t presses;
+    bool pressed;
+    bool held;
+    uint32_t press_ticks;
+    uint32_t fired;
+    // Шаблоны, действия которых выполнило последнее событие, с повторами
+    uint32_t acted;
+} gesture_engine_t;
+
+/**
+ * @brief Инициализация распознавателя
+ * @param engine    Распознаватель
+ * @param patterns  Таблица шаблонов (не более GESTURE_MAX_PATTERNS)
+ * @param count     Число шаблонов
+ * @param tick_freq Частота тиков меток времени, Гц
+ */
+void gesture_init(gesture_engine_t *engine, const gesture_pattern *patterns, uint8_t count, uint32_t tick_freq);
+
+/**
+ * @brief Обработка события автомата кнопки
+ * @param event Событие
+ * @param ticks Метка времени события
+ * @return Маска шаблонов, распознанных этим событием (повторы удержания не входят)
+ */
+uint32_t gesture_process(gesture_engine_t *engine, button_fsm_event event, uint32_t ticks);
+
+/**
+ * @brief Время удержания текущего нажатия в мс, 0 если кнопка отпущена
+ * @param ticks Текущее время
+ */
+uint32_t gesture_hold_ms(const gesture_engine_t *engine, uint32_t ticks);
+
+#endif // BUTTON_GESTURE_H
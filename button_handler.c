@@ -1,9 +1,22 @@
 #include "button_handler.h"
+#include "button_fsm.h"
+#include "button_gesture.h"
+#include "latency_trace.h"
+#include "rtc_clock.h"
+
+#include <string.h>
 
 #include "nrf_gpio.h"
 #include "nrfx_gpiote.h"
 
+#include "app_error.h"
 #include "app_timer.h"
+#include "app_util.h"
+#include "nrf.h"
+#include "nrfx_ppi.h"
+#include "nrf_rtc.h"
+#include "nrf_timer.h"
+#include "nrf_atomic.h"
 
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
@@ -17,146 +30,514 @@
 #define LONG_PRESS_INITIAL_INTERVAL APP_TIMER_TICKS(1000)
 #define LONG_PRESS_REPEAT_INTERVAL APP_TIMER_TICKS(30)
 
-APP_TIMER_DEF(timer_debounce);
-APP_TIMER_DEF(timer_double_click);
-APP_TIMER_DEF(timer_long_press);
-APP_TIMER_DEF(timer_long_press_repeat);
+// 0 - событие PORT через механизм SENSE: канал GPIOTE IN не занимается и в
+//     простое (__WFI) потребление минимально, направление фронта отслеживается
+//     программно переключением SENSE в драйвере
+// 1 - отдельный канал GPIOTE IN: меньше задержка обнаружения фронта, но канал
+//     держит тактирование GPIOTE включенным и заметно увеличивает ток простоя
+#ifndef BUTTON_GPIOTE_HI_ACCURACY
+#define BUTTON_GPIOTE_HI_ACCURACY 0
+#endif
+
+// 1 - антидребезг без процессора: фронт через PPI перезапускает RTC2, процессор
+//     просыпается по сравнению RTC2 только когда уровень держится весь интервал
+//     антидребезга. Требует канал GPIOTE IN на каждую кнопку, фронты считает
+//     TIMER2 в режиме счетчика
+#ifndef BUTTON_HW_DEBOUNCE
+#define BUTTON_HW_DEBOUNCE 0
+#endif
+
+#if BUTTON_HW_DEBOUNCE
+#define BUTTON_HW_RTC NRF_RTC2
+#define BUTTON_HW_EDGE_COUNTER NRF_TIMER2
+#endif
+
+// Очередь событий от прерываний к основному циклу, размер - степень двойки
+#define BUTTON_QUEUE_SIZE 16
+
+// 1 - вызывать колбэки прямо из прерывания (прежнее поведение, для сравнения
+// времени обработки прерываний через button_irq_max_cycles())
+#ifndef BUTTON_DISPATCH_FROM_IRQ
+#define BUTTON_DISPATCH_FROM_IRQ 0
+#endif
+
+// Один таймер на все сроки всех кнопок: антидребезг, окно кликов, начало и
+// повтор долгого нажатия
+APP_TIMER_DEF(timer_button);
+
+typedef struct
+{
+    button_fsm_t fsm;
+    gesture_engine_t gestures;
+    uint32_t pin;
+} button_t;
+
+static button_t buttons[BUTTON_MAX_COUNT];
+static uint8_t button_count = 0;
+
+// Кнопка по номеру вывода, BUTTON_NONE - вывод не используется
+#define BUTTON_NONE 0xFF
+static uint8_t button_by_pin[NUMBER_OF_PINS];
+
+// Кнопки с ожидающими сроками, проверяются при срабатывании таймера
+static uint32_t buttons_active = 0;
+
+static button_fsm_timer_t button_timer = {.scheduled = false};
+
+// Событие, которое передается распознавателю жестов; пишется и читается
+// только в контексте button_dispatch()
+static uint8_t dispatch_button = 0;
+static uint32_t dispatch_ticks = 0;
+
+// Время последнего чтения часов, момент обработки текущего события автомата
+static uint32_t rtc_ticks = 0;
+
+// Очередь с одним писателем (прерывания кнопок одного приоритета) и одним
+// читателем (основной цикл): писатель меняет только head, читатель только tail
+static volatile button_fsm_event queue_events[BUTTON_QUEUE_SIZE];
+static volatile uint8_t queue_buttons[BUTTON_QUEUE_SIZE];
+static volatile uint32_t queue_ticks[BUTTON_QUEUE_SIZE];
+static volatile uint32_t queue_cycles[BUTTON_QUEUE_SIZE];
+static volatile uint8_t queue_head = 0;
+static volatile uint8_t queue_tail = 0;
+static volatile uint32_t queue_dropped = 0;
 
-static volatile bool first_click_detected = false;
-static volatile bool double_click_detected = false;
-static volatile bool long_press_active = false;
+static volatile uint32_t irq_max_cycles = 0;
 
-static volatile uint8_t click_counter = 0;
+// Фронты на выводах кнопок против пробуждений процессора ради кнопок
+static volatile uint32_t raw_edges = 0;
+static volatile uint32_t wakeups = 0;
 
-static click_callback callback_single_click = NULL;
-static click_callback callback_double_click = NULL;
-static click_callback callback_long_press = NULL;
+// Журнал фронтов и жестов: слот занимается атомарным инкрементом, поэтому
+// писать можно и из прерываний, и из основного цикла
+static button_log_entry log_entries[BUTTON_LOG_SIZE];
+static nrf_atomic_u32_t log_head = 0;
 
-static void debounce_timer_handler(void *p_context);
-static void double_click_timer_handler(void *p_context);
-static void long_press_timer_handler(void *p_context);
-static void long_press_repeat_timer_handler(void *p_context);
+static void button_timer_handler(void *p_context);
 static void button_interrupt_handler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action);
-static void process_button_click(void);
-static bool is_button_pressed(void);
+static void button_event_handler(button_fsm_t *fsm, button_fsm_event event);
+static void button_dispatch(uint8_t index, button_fsm_event event, uint32_t ticks, uint32_t cycles);
+static void button_schedule(button_t *button, uint32_t now);
+static uint32_t button_now(void);
+static void button_irq_measure(uint32_t start);
+static void button_log(button_log_type type, uint8_t index, uint8_t value, uint32_t ticks);
+#if BUTTON_HW_DEBOUNCE
+static void button_hw_debounce_init(void);
+static void button_hw_debounce_attach(uint32_t pin);
+#endif
+static bool is_button_pressed(const button_t *button);
 
-void button_init(click_callback on_single_click, click_callback on_double_click, click_callback on_long_press)
+void button_init(const button_config_t *configs, uint8_t count)
 {
-    callback_single_click = on_single_click;
-    callback_double_click = on_double_click;
-    callback_long_press = on_long_press;
-    NRF_LOG_INFO("Callbacks for button init");
+    button_fsm_config_t fsm_config = {
+        .debounce_ticks = DEBOUNCE_INTERVAL,
+        .double_click_ticks = DOUBLE_CLICK_INTERVAL,
+        .long_press_ticks = LONG_PRESS_INITIAL_INTERVAL,
+        .repeat_ticks = LONG_PRESS_REPEAT_INTERVAL};
 
-    nrfx_gpiote_init();
-    nrfx_gpiote_in_config_t button_config = NRFX_GPIOTE_CONFIG_IN_SENSE_TOGGLE(false);
-    button_config.pull = NRF_GPIO_PIN_PULLUP;
-    nrfx_gpiote_in_init(BUTTON_PIN, &button_config, button_interrupt_handler);
-    nrfx_gpiote_in_event_enable(BUTTON_PIN, true);
-    NRF_LOG_INFO("GPIOTE for button init");
+    button_count = count > BUTTON_MAX_COUNT ? BUTTON_MAX_COUNT : count;
+    memset(button_by_pin, BUTTON_NONE, sizeof(button_by_pin));
+
+    for (uint8_t i = 0; i < button_count; ++i)
+    {
+        buttons[i].pin = configs[i].pin;
+        button_by_pin[configs[i].pin] = i;
+        button_fsm_init(&buttons[i].fsm, &fsm_config, button_event_handler);
+        gesture_init(&buttons[i].gestures, configs[i].gestures, configs[i].gesture_count, APP_TIMER_CLOCK_FREQ);
+    }
+    NRF_LOG_INFO("Buttons init: %d", button_count);
 
     app_timer_init();
-    app_timer_create(&timer_debounce, APP_TIMER_MODE_SINGLE_SHOT, debounce_timer_handler);
-    app_timer_create(&timer_double_click, APP_TIMER_MODE_SINGLE_SHOT, double_click_timer_handler);
-    app_timer_create(&timer_long_press, APP_TIMER_MODE_SINGLE_SHOT, long_press_timer_handler);
-    app_timer_create(&timer_long_press_repeat, APP_TIMER_MODE_REPEATED, long_press_repeat_timer_handler);
-    NRF_LOG_INFO("Timer for button init");
+    app_timer_create(&timer_button, APP_TIMER_MODE_SINGLE_SHOT, button_timer_handler);
+    NRF_LOG_INFO("Timer for buttons init");
+
+    // В режиме PORT все кнопки используют одно событие PORT и ни одного канала GPIOTE IN
+    if (!nrfx_gpiote_is_init())
+    {
+        APP_ERROR_CHECK(nrfx_gpiote_init());
+    }
+#if BUTTON_HW_DEBOUNCE
+    button_hw_debounce_init();
+#endif
+    for (uint8_t i = 0; i < button_count; ++i)
+    {
+        nrfx_gpiote_in_config_t button_config =
+            NRFX_GPIOTE_CONFIG_IN_SENSE_TOGGLE(BUTTON_GPIOTE_HI_ACCURACY || BUTTON_HW_DEBOUNCE);
+        button_config.pull = NRF_GPIO_PIN_PULLUP;
+        // Вывод занят или в режиме IN не хватило каналов GPIOTE - кнопка не работала бы молча
+        APP_ERROR_CHECK(nrfx_gpiote_in_init(buttons[i].pin, &button_config, button_interrupt_handler));
+#if BUTTON_HW_DEBOUNCE
+        // Фронты идут только в PPI, прерывание GPIOTE не нужно
+        button_hw_debounce_attach(buttons[i].pin);
+        nrfx_gpiote_in_event_enable(buttons[i].pin, false);
+#else
+        nrfx_gpiote_in_event_enable(buttons[i].pin, true);
+#endif
+    }
+    NRF_LOG_INFO("GPIOTE for buttons init (%s)",
+                 BUTTON_HW_DEBOUNCE ? "PPI debounce" : BUTTON_GPIOTE_HI_ACCURACY ? "IN channel" : "PORT sense");
 }
 
-static void button_interrupt_handler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+#if BUTTON_HW_DEBOUNCE
+/**
+ * @brief Настройка RTC2 как окна антидребезга и TIMER2 как счетчика фронтов
+ *
+ * RTC2 тактируется так же, как app_timer, поэтому интервал в тиках общий.
+ * Сравнение останавливает RTC2 через PPI, до следующего фронта он не считает.
+ */
+static void button_hw_debounce_init(void)
+{
+    nrf_ppi_channel_t channel;
+
+    nrf_rtc_task_trigger(BUTTON_HW_RTC, NRF_RTC_TASK_STOP);
+    nrf_rtc_prescaler_set(BUTTON_HW_RTC, APP_TIMER_CONFIG_RTC_FREQUENCY);
+    nrf_rtc_cc_set(BUTTON_HW_RTC, 0, DEBOUNCE_INTERVAL);
+    nrf_rtc_event_clear(BUTTON_HW_RTC, NRF_RTC_EVENT_COMPARE_0);
+    nrf_rtc_event_enable(BUTTON_HW_RTC, NRF_RTC_INT_COMPARE0_MASK);
+    nrf_rtc_int_enable(BUTTON_HW_RTC, NRF_RTC_INT_COMPARE0_MASK);
+    NRFX_IRQ_PRIORITY_SET(RTC2_IRQn, APP_TIMER_CONFIG_IRQ_PRIORITY);
+    NRFX_IRQ_ENABLE(RTC2_IRQn);
+
+    APP_ERROR_CHECK(nrfx_ppi_channel_alloc(&channel));
+    APP_ERROR_CHECK(nrfx_ppi_channel_assign(channel,
+                                            nrf_rtc_event_address_get(BUTTON_HW_RTC, NRF_RTC_EVENT_COMPARE_0),
+                                            nrf_rtc_task_address_get(BUTTON_HW_RTC, NRF_RTC_TASK_STOP)));
+    APP_ERROR_CHECK(nrfx_ppi_channel_enable(channel));
+
+    nrf_timer_mode_set(BUTTON_HW_EDGE_COUNTER, NRF_TIMER_MODE_COUNTER);
+    nrf_timer_bit_width_set(BUTTON_HW_EDGE_COUNTER, NRF_TIMER_BIT_WIDTH_32);
+    nrf_timer_task_trigger(BUTTON_HW_EDGE_COUNTER, NRF_TIMER_TASK_CLEAR);
+    nrf_timer_task_trigger(BUTTON_HW_EDGE_COUNTER, NRF_TIMER_TASK_START);
+}
+
+/**
+ * @brief Связь событий GPIOTE IN кнопки с окном антидребезга и счетчиком фронтов
+ *
+ * Два канала PPI на кнопку: фронт обнуляет и запускает RTC2 (каждый дребезг
+ * отодвигает окончание окна) и увеличивает счетчик фронтов.
+ */
+static void button_hw_debounce_attach(uint32_t pin)
+{
+    nrf_ppi_channel_t channel;
+    uint32_t edge = nrfx_gpiote_in_event_addr_get(pin);
+
+    // Каналов PPI не хватило - антидребезг или счетчик фронтов не работали бы молча
+    APP_ERROR_CHECK(nrfx_ppi_channel_alloc(&channel));
+    APP_ERROR_CHECK(nrfx_ppi_channel_assign(channel, edge, nrf_rtc_task_address_get(BUTTON_HW_RTC, NRF_RTC_TASK_CLEAR)));
+    APP_ERROR_CHECK(nrfx_ppi_channel_fork_assign(channel, nrf_rtc_task_address_get(BUTTON_HW_RTC, NRF_RTC_TASK_START)));
+    APP_ERROR_CHECK(nrfx_ppi_channel_enable(channel));
+
+    APP_ERROR_CHECK(nrfx_ppi_channel_alloc(&channel));
+    APP_ERROR_CHECK(
+        nrfx_ppi_channel_assign(channel, edge, nrf_timer_task_address_get(BUTTON_HW_EDGE_COUNTER, NRF_TIMER_TASK_COUNT)));
+    APP_ERROR_CHECK(nrfx_ppi_channel_enable(channel));
+}
+
+/**
+ * @brief Окончание окна антидребезга: уровни всех кнопок стабильны
+ *
+ * Окно общее для всех кнопок, поэтому после него проверяются все автоматы;
+ * автомат кнопки без смены уровня событий не выдает.
+ */
+void RTC2_IRQHandler(void)
 {
-    if (is_button_pressed())
+    uint32_t start = DWT->CYCCNT;
+
+    nrf_rtc_event_clear(BUTTON_HW_RTC, NRF_RTC_EVENT_COMPARE_0);
+    wakeups++;
+
+    uint32_t now = button_now();
+
+    // Момент фронта процессору неизвестен, трасса начинается с пробуждения
+    latency_trace_mark(LATENCY_STAGE_EDGE);
+    for (uint8_t i = 0; i < button_count; ++i)
     {
-        app_timer_start(timer_debounce, DEBOUNCE_INTERVAL, NULL);
+        button_t *button = &buttons[i];
+
+        bool pressed = is_button_pressed(button);
+
+        button_log(BUTTON_LOG_LEVEL, i, pressed, now);
+        button_fsm_settled(&button->fsm, now, pressed);
+        buttons_active |= 1UL << i;
+        button_schedule(button, now);
     }
+    latency_trace_cancel_before(LATENCY_STAGE_DEBOUNCE);
+    button_irq_measure(start);
 }
+#endif
 
-static void debounce_timer_handler(void *p_context)
+/**
+ * @brief Текущее время в тиках RTC, младшие 32 бита общих часов rtc_clock
+ *
+ * Часы идут и во время простоя кнопок, поэтому метки журнала кнопок
+ * сравнимы между собой и с другими модулями. Сравнения в автомате учитывают
+ * переполнение 32 бит (раз в 72 часа).
+ */
+static uint32_t button_now(void)
 {
-    if (is_button_pressed())
+    rtc_ticks = (uint32_t)rtc_clock_ticks();
+    return rtc_ticks;
+}
+
+/**
+ * @brief Учет сроков кнопки в общем таймере
+ *
+ * Решение принимает button_fsm, здесь только работа с app_timer.
+ */
+static void button_schedule(button_t *button, uint32_t now)
+{
+    uint32_t timeout;
+
+    switch (button_fsm_schedule(&button_timer, &button->fsm, now, APP_TIMER_MIN_TIMEOUT_TICKS, &timeout))
     {
-        if (!long_press_active)
-        {
-            app_timer_start(timer_long_press, LONG_PRESS_INITIAL_INTERVAL, NULL);
-        }
+    case BUTTON_FSM_TIMER_RESTART:
+        app_timer_stop(timer_button);
+        app_timer_start(timer_button, timeout, NULL);
+        break;
+
+    case BUTTON_FSM_TIMER_START:
+        app_timer_start(timer_button, timeout, NULL);
+        break;
+
+    case BUTTON_FSM_TIMER_KEEP:
+    default:
+        break;
+    }
+}
 
-        process_button_click();
+/**
+ * @brief Учет длительности обработчика прерывания кнопки
+ * @param start значение DWT->CYCCNT на входе в обработчик
+ */
+static void button_irq_measure(uint32_t start)
+{
+    uint32_t cycles = DWT->CYCCNT - start;
+    if (cycles > irq_max_cycles)
+    {
+        irq_max_cycles = cycles;
     }
-    else
+}
+
+/**
+ * @brief Фронт на любой кнопке: работа только с автоматом этой кнопки
+ */
+static void button_interrupt_handler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+{
+    uint32_t start = DWT->CYCCNT;
+    uint8_t index = pin < NUMBER_OF_PINS ? button_by_pin[pin] : BUTTON_NONE;
+
+    if (index == BUTTON_NONE)
     {
-        app_timer_stop(timer_long_press);
-        app_timer_stop(timer_long_press_repeat);
-        long_press_active = false;
+        return;
     }
+
+    uint32_t now = button_now();
+    button_t *button = &buttons[index];
+
+    raw_edges++;
+    wakeups++;
+    button_log(BUTTON_LOG_EDGE, index, is_button_pressed(button), now);
+    latency_trace_mark(LATENCY_STAGE_EDGE);
+    button_fsm_edge(&button->fsm, now);
+    buttons_active |= 1UL << index;
+    button_schedule(button, now);
+    button_irq_measure(start);
 }
 
-static void process_button_click(void)
+static void button_timer_handler(void *p_context)
 {
-    click_counter++;
+    uint32_t start = DWT->CYCCNT;
+    uint32_t now = button_now();
+    uint32_t active = buttons_active;
+    bool settled = true;
 
-    app_timer_start(timer_double_click, DOUBLE_CLICK_INTERVAL, NULL);
+    wakeups++;
+    button_fsm_timer_expired(&button_timer);
 
-    switch (click_counter)
+    while (active)
     {
-    case 1:
-        if (callback_single_click)
+        uint8_t index = __builtin_ctz(active);
+        button_t *button = &buttons[index];
+        uint32_t deadline;
+
+        active &= active - 1;
+
+        button_fsm_process(&button->fsm, now, is_button_pressed(button));
+        if (button->fsm.debounce_pending)
         {
-            callback_single_click();
+            settled = false;
         }
-        break;
-    case 2:
-        if (callback_double_click)
+
+        if (button_fsm_next_deadline(&button->fsm, &deadline))
         {
-            NRF_LOG_INFO("Double click detected");
-            callback_double_click();
+            button_schedule(button, now);
         }
-        break;
+        else
+        {
+            buttons_active &= ~(1UL << index);
+        }
+    }
 
-    default:
-        break;
+    if (settled)
+    {
+        // Дребезг без смены уровня - трасса задержки не продолжится
+        latency_trace_cancel_before(LATENCY_STAGE_DEBOUNCE);
     }
+    button_irq_measure(start);
 }
 
-static void double_click_timer_handler(void *p_context)
+/**
+ * @brief Передача события автомата в основной цикл
+ */
+static void button_event_handler(button_fsm_t *fsm, button_fsm_event event)
 {
-    app_timer_stop(timer_double_click);
-    first_click_detected = false;
-    click_counter = 0;
+    uint8_t index = (uint8_t)(CONTAINER_OF(fsm, button_t, fsm) - buttons);
+    uint32_t cycles = DWT->CYCCNT;
+
+    // События возникают внутри button_fsm_process(), rtc_ticks - момент
+    // обработки. Нажатие датируется первым фронтом, а не окончанием антидребезга
+    uint32_t ticks = event == BUTTON_FSM_EVT_PRESS ? fsm->burst_ticks : rtc_ticks;
+    if (event == BUTTON_FSM_EVT_PRESS || event == BUTTON_FSM_EVT_RELEASE)
+    {
+        latency_trace_mark(LATENCY_STAGE_DEBOUNCE);
+    }
+
+#if BUTTON_DISPATCH_FROM_IRQ
+    button_dispatch(index, event, ticks, cycles);
+#else
+    uint8_t head = queue_head;
+    uint8_t next = (head + 1) % BUTTON_QUEUE_SIZE;
+
+    if (next == queue_tail)
+    {
+        queue_dropped++;
+        return;
+    }
+
+    queue_events[head] = event;
+    queue_buttons[head] = index;
+    queue_ticks[head] = ticks;
+    queue_cycles[head] = cycles;
+    __DMB();
+    queue_head = next;
+#endif
 }
 
-static void long_press_timer_handler(void *p_context)
+void button_process(void)
 {
-    if (is_button_pressed())
+    while (queue_tail != queue_head)
     {
-        long_press_active = true;
+        uint8_t tail = queue_tail;
 
-        if (callback_long_press)
-        {
-            NRF_LOG_INFO("Long press detected");
-            callback_long_press();
-        }
+        __DMB();
+        button_fsm_event event = queue_events[tail];
+        uint8_t index = queue_buttons[tail];
+        uint32_t ticks = queue_ticks[tail];
+        uint32_t cycles = queue_cycles[tail];
+        __DMB();
+        queue_tail = (tail + 1) % BUTTON_QUEUE_SIZE;
 
-        app_timer_start(timer_long_press_repeat, LONG_PRESS_REPEAT_INTERVAL, NULL);
+        button_dispatch(index, event, ticks, cycles);
     }
 }
 
-static void long_press_repeat_timer_handler(void *p_context)
+uint32_t button_irq_max_cycles(bool reset)
 {
-    if (is_button_pressed())
+    uint32_t cycles = irq_max_cycles;
+    if (reset)
     {
-        if (callback_long_press)
-        {
-            callback_long_press();
-        }
+        irq_max_cycles = 0;
+    }
+    return cycles;
+}
+
+void button_debounce_stats(uint32_t *edges, uint32_t *cpu_wakeups, bool reset)
+{
+#if BUTTON_HW_DEBOUNCE
+    nrf_timer_task_trigger(BUTTON_HW_EDGE_COUNTER, NRF_TIMER_TASK_CAPTURE0);
+    *edges = nrf_timer_cc_read(BUTTON_HW_EDGE_COUNTER, NRF_TIMER_CC_CHANNEL0);
+#else
+    *edges = raw_edges;
+#endif
+    *cpu_wakeups = wakeups;
+
+    if (reset)
+    {
+#if BUTTON_HW_DEBOUNCE
+        nrf_timer_task_trigger(BUTTON_HW_EDGE_COUNTER, NRF_TIMER_TASK_CLEAR);
+#endif
+        raw_edges = 0;
+        wakeups = 0;
     }
-    else
+}
+
+/**
+ * @brief Передача события распознавателю жестов
+ * @param cycles такт DWT, на котором автомат выдал событие
+ */
+static void button_dispatch(uint8_t index, button_fsm_event event, uint32_t ticks, uint32_t cycles)
+{
+    uint32_t start = DWT->CYCCNT;
+
+    dispatch_button = index;
+    dispatch_ticks = ticks;
+    uint32_t recognized = gesture_process(&buttons[index].gestures, event, ticks);
+
+    // Трасса продолжается только событием, выполнившим действие жеста:
+    // после него состояние светодиодов уже обновлено
+    if (buttons[index].gestures.acted)
     {
-        NRF_LOG_INFO("Long press repeat end");
-        app_timer_stop(timer_long_press_repeat);
-        long_press_active = false;
+        latency_trace_dispatch(cycles, start);
+        latency_trace_mark(LATENCY_STAGE_UPDATE);
     }
+
+    while (recognized)
+    {
+        button_log(BUTTON_LOG_GESTURE, index, __builtin_ctz(recognized), ticks);
+        recognized &= recognized - 1;
+    }
+}
+
+/**
+ * @brief Запись в журнал кнопок: несколько десятков тактов, без форматирования
+ */
+static void button_log(button_log_type type, uint8_t index, uint8_t value, uint32_t ticks)
+{
+    button_log_entry *entry = &log_entries[nrf_atomic_u32_fetch_add(&log_head, 1) % BUTTON_LOG_SIZE];
+
+    entry->ticks = ticks;
+    entry->type = type;
+    entry->button = index;
+    entry->value = value;
+}
+
+uint8_t button_log_read(button_log_entry *entries)
+{
+    uint32_t head = log_head;
+    uint8_t count = head < BUTTON_LOG_SIZE ? head : BUTTON_LOG_SIZE;
+
+    // Запись во время чтения может заменить самые старые записи - для
+    // диагностики это допустимо
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        entries[i] = log_entries[(head - count + i) % BUTTON_LOG_SIZE];
+    }
+    return count;
+}
+
+uint32_t button_hold_time_ms(void)
+{
+    return gesture_hold_ms(&buttons[dispatch_button].gestures, dispatch_ticks);
+}
+
+uint64_t button_press_ticks(void)
+{
+    // Метка нажатия - младшие 32 бита rtc_clock, нажатие не старше 72 часов
+    uint64_t now = rtc_clock_ticks();
+    return now - (uint32_t)((uint32_t)now - buttons[dispatch_button].gestures.press_ticks);
 }
 
-static bool is_button_pressed(void)
+static bool is_button_pressed(const button_t *button)
 {
-    return nrf_gpio_pin_read(BUTTON_PIN) == 0;
+    return nrf_gpio_pin_read(button->pin) == 0;
 }
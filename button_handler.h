@@ -4,17 +4,98 @@
 #include <stdbool.h>
 #include "nrfx_gpiote.h"
 
+#include "button_gesture.h"
+
 #define BUTTON_PIN NRF_GPIO_PIN_MAP(1, 6)
 
-typedef void (*click_callback)(void);
+#define BUTTON_MAX_COUNT 8
+
+// Число записей журнала кнопок, степень двойки
+#define BUTTON_LOG_SIZE 32
+
+typedef enum
+{
+    BUTTON_LOG_EDGE,    // фронт, value - уровень после фронта (1 - нажата)
+    BUTTON_LOG_LEVEL,   // уровень после аппаратного антидребезга, value - уровень
+    BUTTON_LOG_GESTURE  // распознанный жест, value - индекс шаблона в таблице
+} button_log_type;
+
+typedef struct
+{
+    uint32_t ticks;     // метка времени rtc_clock в тиках app_timer (младшие 32 бита)
+    uint8_t type;
+    uint8_t button;
+    uint8_t value;
+} button_log_entry;
+
+typedef struct
+{
+    uint32_t pin;
+    const gesture_pattern *gestures;
+    uint8_t gesture_count;
+} button_config_t;
 
 /**
  * @brief Инициализация обработчика кнопок
  *
- * @param on_single_click Колбэк для одиночного клика
- * @param on_double_click Колбэк для двойного клика
- * @param on_long_press   Колбэк для долгого нажатия
+ * Все кнопки используют один таймер и событие GPIOTE PORT, у каждой свой
+ * автомат состояний и своя таблица жестов.
+ *
+ * @param configs Вывод и таблица жестов каждой кнопки
+ * @param count   Число кнопок (не более BUTTON_MAX_COUNT)
+ */
+void button_init(const button_config_t *configs, uint8_t count);
+
+/**
+ * @brief Вызов колбэков для событий, накопленных прерываниями кнопки
+ *
+ * Вызывается из основного цикла, поэтому колбэки (в том числе запись во флеш)
+ * выполняются вне контекста прерывания.
+ */
+void button_process(void);
+
+/**
+ * @brief Максимальная длительность обработчика прерывания кнопки
+ * @param reset сбросить максимум после чтения
+ * @return Длительность в тактах процессора
+ */
+uint32_t button_irq_max_cycles(bool reset);
+
+/**
+ * @brief Счетчики фронтов на выводах кнопок и пробуждений процессора ради них
+ * @param edges       Число фронтов, включая дребезг
+ * @param cpu_wakeups Число прерываний кнопок (фронты, таймер, окно антидребезга)
+ * @param reset       Сбросить счетчики после чтения
+ */
+void button_debounce_stats(uint32_t *edges, uint32_t *cpu_wakeups, bool reset);
+
+/**
+ * @brief Копия журнала фронтов и жестов, от старых записей к новым
+ * @param entries Буфер на BUTTON_LOG_SIZE записей
+ * @return Число скопированных записей
+ */
+uint8_t button_log_read(button_log_entry *entries);
+
+/**
+ * @brief Время удержания кнопки, чье событие сейчас обрабатывается
+ *
+ * Вызывается только из действия жеста: кнопка, метка события и состояние
+ * распознавателя меняются в button_dispatch() в том же контексте (основной
+ * цикл, или прерывания кнопок одного приоритета при BUTTON_DISPATCH_FROM_IRQ),
+ * поэтому чтение не пересекается с их записью. Из другого контекста
+ * результат не определен.
+ * @return Время с момента нажатия в мс, 0 если кнопка отпущена
+ */
+uint32_t button_hold_time_ms(void);
+
+/**
+ * @brief Момент последнего нажатия кнопки, чье событие сейчас обрабатывается
+ *
+ * Первый фронт нажатия по часам rtc_clock, без задержки антидребезга, окна
+ * кликов и основного цикла. Вызывается только из действия жеста, как
+ * button_hold_time_ms().
+ * @return Время нажатия в тиках app_timer
  */
-void button_init(click_callback on_single_click, click_callback on_double_click, click_callback on_long_press);
+uint64_t button_press_ticks(void);
 
 #endif // BUTTON_HANDLER_H
\ No newline at end of file
@@ -5,17 +5,39 @@
  * - Прием и обработку команд через USB
  * - Эхо введенных символов
  * - Поддержку команд RGB и HSV для управления цветом
+ * - Настройку плавного перехода между цветами (FADE)
+ * - Загрузку градиентных палитр (PALETTE, PALSAMPLE)
+ * - Управление темпом и эффектами (BPM, EFFECT)
+ * - Настройку ускорения при долгом нажатии (RAMP)
+ * - Вывод максимальной длительности прерываний кнопки (IRQMAX)
+ * - Вывод числа фронтов и пробуждений от кнопок (BTNSTAT)
+ * - Вывод журнала фронтов и жестов кнопок (BTNLOG)
+ * - Вывод гистограмм задержки от нажатия до ШИМ (LATENCY)
+ * - Настройку и счетчики отложенного сохранения (PERSIST)
+ * - Вызов и сохранение пресетов цвета (PRESET)
+ * - Вывод наибольшего времени блокировки флеш-операциями (FLASHSTAT)
  * - Валидацию введенных значений
  */
 
 #include "cli_control.h"
 #include "led_control.h"
+#include "palette_control.h"
+#include "effect_clock.h"
+#include "button_handler.h"
+#include "latency_trace.h"
+#include "persist_policy.h"
+#include "preset_bank.h"
+#include "nvmc_control.h"
+#include "rtc_clock.h"
 
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <ctype.h>
 
+#include "nrf.h"
+#include "app_timer.h"
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
 #include "nrf_log_default_backends.h"
@@ -23,7 +45,11 @@
 #include "app_usbd_cdc_acm.h"
 
 #define READ_SIZE 1
-#define MAX_CMD_SIZE 64
+#define MAX_CMD_SIZE 160
+#define CLI_FADE_MAX_MS 10000
+#define LATENCY_REPORT_SIZE 768
+#define BTNLOG_REPORT_SIZE (48 + BUTTON_LOG_SIZE * 16)
+#define PRESET_REPORT_SIZE (16 + PRESET_COUNT * 32)
 
 static char m_rx_buffer[READ_SIZE];
 static char m_cmd_buffer[MAX_CMD_SIZE];
@@ -31,6 +57,9 @@ static uint8_t m_cmd_pos = 0;
 
 static void process_command(void);
 static void send_response(const char *str);
+static void send_latency_histograms(void);
+static void send_button_log(void);
+static void send_preset_list(void);
 static void cdc_acm_user_ev_handler(app_usbd_class_inst_t const *p_inst,
                                     app_usbd_cdc_acm_user_event_t event);
 
@@ -142,6 +171,20 @@ static void process_command(void)
             "Commands:\r\n"
             "RGB <r> <g> <b> - r - red [0..255], g - green [0..255], b - blue [0..255]\r\n"
             "HSV <h> <s> <v> - h - hue [0..360], s - saturation [0..100], v - value/brightness [0..100]\r\n"
+            "FADE <ms> <linear|smooth> - color transition time [0..10000] and easing\r\n"
+            "HUELUMA <0|1> - constant brightness across hue (dims to blue: green ~10%, yellow ~8%)\r\n"
+            "PALETTE <PPRRGGBB> ... - load and save gradient of 2..16 hex stops (PP - position)\r\n"
+            "PALSAMPLE <p> - set color from palette position [0..255]\r\n"
+            "BPM [bpm] - show or set effect tempo [20..300], fractional allowed\r\n"
+            "EFFECT <none|palette|pulse> - tempo-synchronized effect\r\n"
+            "RAMP <fine_ms> <accel_ms> <hue_step> <sb_step> - long press acceleration\r\n"
+            "IRQMAX - show and reset worst-case button interrupt duration\r\n"
+            "BTNSTAT [reset] - button raw edges vs CPU wakeups\r\n"
+            "BTNLOG - button edge and gesture log (hex RTC ticks)\r\n"
+            "LATENCY [reset] - button-to-PWM latency histograms (log2 us buckets)\r\n"
+            "PERSIST [reset | <quiet_ms> <max_ms>] - settings save counters or timing\r\n"
+            "PRESET <n> | SAVE <n> [name] | LIST - recall, store or list color presets (0-15)\r\n"
+            "FLASHSTAT [reset] - longest CPU stall per flash step, word write and erase slice\r\n"
             "help - show this message\r\n");
     }
     else if (strcmp(cmd_upper, "RGB") == 0)
@@ -210,6 +253,346 @@ static void process_command(void)
             send_response("\r\nInvalid HSV command format\r\n");
         }
     }
+    else if (strcmp(cmd_upper, "FADE") == 0)
+    {
+        char *ms_str = strtok(NULL, " ");
+        char *easing_str = strtok(NULL, " ");
+
+        if (ms_str && easing_str)
+        {
+            int ms = atoi(ms_str);
+            bool smooth = strcasecmp(easing_str, "smooth") == 0;
+            bool linear = strcasecmp(easing_str, "linear") == 0;
+
+            if (ms >= 0 && ms <= CLI_FADE_MAX_MS && (smooth || linear))
+            {
+                NRF_LOG_INFO("Setting fade: %d ms, %s", ms, smooth ? "smooth" : "linear");
+                led_set_fade((uint32_t)ms, smooth ? FADE_EASING_SMOOTH : FADE_EASING_LINEAR);
+
+                snprintf(response, sizeof(response),
+                         "\r\nFade set to %d ms %s\r\n", ms, smooth ? "smooth" : "linear");
+                send_response(response);
+            }
+            else
+            {
+                NRF_LOG_WARNING("Invalid FADE values: %d ms", ms);
+                send_response("\r\nInvalid FADE values (ms: 0-10000, easing: linear/smooth)\r\n");
+            }
+        }
+        else
+        {
+            NRF_LOG_WARNING("Invalid FADE command format received");
+            send_response("\r\nInvalid FADE command format\r\n");
+        }
+    }
+    else if (strcmp(cmd_upper, "HUELUMA") == 0)
+    {
+        char *on_str = strtok(NULL, " ");
+
+        if (on_str && (strcmp(on_str, "0") == 0 || strcmp(on_str, "1") == 0))
+        {
+            bool enabled = on_str[0] == '1';
+            NRF_LOG_INFO("Hue luma compensation: %d", enabled);
+            led_set_hue_luma_compensation(enabled);
+
+            snprintf(response, sizeof(response),
+                     "\r\nHue luma compensation %s\r\n", enabled ? "on" : "off");
+            send_response(response);
+        }
+        else
+        {
+            NRF_LOG_WARNING("Invalid HUELUMA command format received");
+            send_response("\r\nInvalid HUELUMA command format (0 or 1)\r\n");
+        }
+    }
+    else if (strcmp(cmd_upper, "PALETTE") == 0)
+    {
+        palette_t palette = {.count = 0};
+        char *stop_str;
+        bool valid = true;
+
+        while ((stop_str = strtok(NULL, " ")) != NULL)
+        {
+            char *end;
+            uint32_t stop = strtoul(stop_str, &end, 16);
+
+            if (palette.count >= PALETTE_MAX_STOPS || *end != '\0' || strlen(stop_str) != 8)
+            {
+                valid = false;
+                break;
+            }
+
+            palette.stops[palette.count].position = (uint8_t)(stop >> 24);
+            palette.stops[palette.count].red = (uint8_t)(stop >> 16);
+            palette.stops[palette.count].green = (uint8_t)(stop >> 8);
+            palette.stops[palette.count].blue = (uint8_t)stop;
+            palette.count++;
+        }
+
+        if (valid && palette_load(&palette))
+        {
+            bool saved = palette_save();
+
+            NRF_LOG_INFO("Palette loaded: %d stops", palette.count);
+            snprintf(response, sizeof(response),
+                     "\r\nPalette loaded: %d stops%s\r\n", (int)palette.count, saved ? "" : " (not saved)");
+            send_response(response);
+        }
+        else
+        {
+            NRF_LOG_WARNING("Invalid PALETTE command received");
+            send_response("\r\nInvalid palette (2-16 stops PPRRGGBB, positions ascending)\r\n");
+        }
+    }
+    else if (strcmp(cmd_upper, "PALSAMPLE") == 0)
+    {
+        char *pos_str = strtok(NULL, " ");
+
+        if (pos_str)
+        {
+            int pos = atoi(pos_str);
+
+            if (pos >= 0 && pos <= 255)
+            {
+                RGB_color color = palette_sample((uint8_t)pos);
+                NRF_LOG_INFO("Palette sample %d: R=%d G=%d B=%d", pos, color.red, color.green, color.blue);
+                led_set_rgb_color(color.red, color.green, color.blue);
+
+                snprintf(response, sizeof(response),
+                         "\r\nColor set to R=%d G=%d B=%d\r\n", color.red, color.green, color.blue);
+                send_response(response);
+            }
+            else
+            {
+                NRF_LOG_WARNING("Invalid palette position: %d", pos);
+                send_response("\r\nInvalid palette position (0-255)\r\n");
+            }
+        }
+        else
+        {
+            NRF_LOG_WARNING("Invalid PALSAMPLE command format received");
+            send_response("\r\nInvalid PALSAMPLE command format\r\n");
+        }
+    }
+    else if (strcmp(cmd_upper, "BPM") == 0)
+    {
+        char *bpm_str = strtok(NULL, " ");
+
+        if (bpm_str == NULL || effect_clock_set_bpm((uint32_t)(atof(bpm_str) * 1000 + 0.5)))
+        {
+            uint32_t bpm = effect_clock_get_bpm();
+            NRF_LOG_INFO("Tempo: %d.%03d BPM", bpm / 1000, bpm % 1000);
+
+            snprintf(response, sizeof(response),
+                     "\r\nTempo %d.%03d BPM\r\n", (int)(bpm / 1000), (int)(bpm % 1000));
+            send_response(response);
+        }
+        else
+        {
+            NRF_LOG_WARNING("Invalid BPM value received");
+            send_response("\r\nInvalid BPM value (20-300)\r\n");
+        }
+    }
+    else if (strcmp(cmd_upper, "EFFECT") == 0)
+    {
+        char *effect_str = strtok(NULL, " ");
+
+        if (effect_str && strcasecmp(effect_str, "none") == 0)
+        {
+            led_set_effect(LED_EFFECT_NONE);
+            send_response("\r\nEffect off\r\n");
+        }
+        else if (effect_str && strcasecmp(effect_str, "palette") == 0)
+        {
+            led_set_effect(LED_EFFECT_PALETTE);
+            send_response("\r\nEffect palette\r\n");
+        }
+        else if (effect_str && strcasecmp(effect_str, "pulse") == 0)
+        {
+            led_set_effect(LED_EFFECT_PULSE);
+            send_response("\r\nEffect pulse\r\n");
+        }
+        else
+        {
+            NRF_LOG_WARNING("Invalid EFFECT command format received");
+            send_response("\r\nInvalid EFFECT command format (none/palette/pulse)\r\n");
+        }
+    }
+    else if (strcmp(cmd_upper, "RAMP") == 0)
+    {
+        char *fine_str = strtok(NULL, " ");
+        char *accel_str = strtok(NULL, " ");
+        char *hue_str = strtok(NULL, " ");
+        char *sb_str = strtok(NULL, " ");
+
+        if (fine_str && accel_str && hue_str && sb_str)
+        {
+            int fine = atoi(fine_str);
+            int accel = atoi(accel_str);
+            int hue = atoi(hue_str);
+            int sb = atoi(sb_str);
+
+            if (fine >= 0 && fine <= 10000 && accel >= 0 && accel <= 10000 &&
+                hue >= 1 && hue <= 60 && sb >= 1 && sb <= 20)
+            {
+                ramp_params params = {
+                    .fine_ms = (uint16_t)fine,
+                    .accel_ms = (uint16_t)accel,
+                    .hue_max_step = (uint8_t)hue,
+                    .sb_max_step = (uint8_t)sb};
+                NRF_LOG_INFO("Setting ramp: %d ms, %d ms, %d, %d", fine, accel, hue, sb);
+                led_set_ramp(&params);
+
+                snprintf(response, sizeof(response),
+                         "\r\nRamp set to %d ms fine, %d ms accel, max steps %d/%d\r\n", fine, accel, hue, sb);
+                send_response(response);
+            }
+            else
+            {
+                NRF_LOG_WARNING("Invalid RAMP values received");
+                send_response("\r\nInvalid RAMP values (ms: 0-10000, hue step: 1-60, s/b step: 1-20)\r\n");
+            }
+        }
+        else
+        {
+            NRF_LOG_WARNING("Invalid RAMP command format received");
+            send_response("\r\nInvalid RAMP command format\r\n");
+        }
+    }
+    else if (strcmp(cmd_upper, "IRQMAX") == 0)
+    {
+        uint32_t cycles = button_irq_max_cycles(true);
+        uint32_t us = cycles / (SystemCoreClock / 1000000);
+
+        NRF_LOG_INFO("Button IRQ max: %d cycles, %d us", cycles, us);
+        snprintf(response, sizeof(response),
+                 "\r\nButton IRQ max: %d cycles (%d us)\r\n", (int)cycles, (int)us);
+        send_response(response);
+    }
+    else if (strcmp(cmd_upper, "BTNSTAT") == 0)
+    {
+        char *arg_str = strtok(NULL, " ");
+        bool reset = arg_str && strcasecmp(arg_str, "reset") == 0;
+        uint32_t edges;
+        uint32_t wakeups;
+
+        button_debounce_stats(&edges, &wakeups, reset);
+        NRF_LOG_INFO("Button edges: %d, wakeups: %d", edges, wakeups);
+        snprintf(response, sizeof(response),
+                 "\r\nButton edges: %d, wakeups: %d\r\n", (int)edges, (int)wakeups);
+        send_response(response);
+    }
+    else if (strcmp(cmd_upper, "BTNLOG") == 0)
+    {
+        send_button_log();
+    }
+    else if (strcmp(cmd_upper, "LATENCY") == 0)
+    {
+        char *arg_str = strtok(NULL, " ");
+
+        if (arg_str && strcasecmp(arg_str, "reset") == 0)
+        {
+            latency_trace_reset();
+            send_response("\r\nLatency histograms reset\r\n");
+        }
+        else
+        {
+            send_latency_histograms();
+        }
+    }
+    else if (strcmp(cmd_upper, "PRESET") == 0)
+    {
+        char *arg_str = strtok(NULL, " ");
+
+        if (arg_str && strcasecmp(arg_str, "LIST") == 0)
+        {
+            send_preset_list();
+        }
+        else if (arg_str && strcasecmp(arg_str, "SAVE") == 0)
+        {
+            char *index_str = strtok(NULL, " ");
+            char *name_str = strtok(NULL, " ");
+            int index = index_str ? atoi(index_str) : -1;
+
+            if (index >= 0 && index < PRESET_COUNT && preset_save((uint32_t)index, name_str))
+            {
+                snprintf(response, sizeof(response), "\r\nPreset %d saved\r\n", index);
+            }
+            else
+            {
+                snprintf(response, sizeof(response),
+                         "\r\nError: preset not saved (index 0-%d, flash queue full?)\r\n", PRESET_COUNT - 1);
+            }
+            send_response(response);
+        }
+        else if (arg_str)
+        {
+            int index = atoi(arg_str);
+
+            if (index >= 0 && index < PRESET_COUNT && preset_recall((uint32_t)index))
+            {
+                snprintf(response, sizeof(response), "\r\nPreset %d recalled\r\n", index);
+            }
+            else
+            {
+                snprintf(response, sizeof(response), "\r\nError: preset %d is empty or invalid\r\n", index);
+            }
+            send_response(response);
+        }
+        else
+        {
+            NRF_LOG_WARNING("Invalid PRESET command format received");
+            send_response("\r\nInvalid PRESET command format\r\n");
+        }
+    }
+    else if (strcmp(cmd_upper, "FLASHSTAT") == 0)
+    {
+        char *arg_str = strtok(NULL, " ");
+        nvmc_stats stats;
+
+        nvmc_get_stats(&stats, arg_str && strcasecmp(arg_str, "reset") == 0);
+        NRF_LOG_INFO("Flash max step %d us, write %d us, erase %d us",
+                     stats.max_step_us, stats.max_write_us, stats.max_erase_us);
+        snprintf(response, sizeof(response),
+                 "\r\nFlash max step: %d us, word write: %d us, erase slice: %d us\r\n"
+                 "Erase slices: %d, words written: %d\r\n",
+                 (int)stats.max_step_us, (int)stats.max_write_us, (int)stats.max_erase_us,
+                 (int)stats.erase_slices, (int)stats.words_written);
+        send_response(response);
+    }
+    else if (strcmp(cmd_upper, "PERSIST") == 0)
+    {
+        char *quiet_str = strtok(NULL, " ");
+        char *max_str = strtok(NULL, " ");
+        persist_stats_t stats;
+
+        if (quiet_str && max_str)
+        {
+            int quiet_ms = atoi(quiet_str);
+            int max_ms = atoi(max_str);
+
+            if (quiet_ms >= 0 && max_ms >= 0 && persist_set_timing((uint32_t)quiet_ms, (uint32_t)max_ms))
+            {
+                snprintf(response, sizeof(response),
+                         "\r\nSave after %d ms quiet, at most %d ms after change\r\n", quiet_ms, max_ms);
+            }
+            else
+            {
+                snprintf(response, sizeof(response),
+                         "\r\nError: need 0 <= quiet_ms <= max_ms <= %d\r\n", PERSIST_MAX_DELAY_MS_LIMIT);
+            }
+            send_response(response);
+        }
+        else
+        {
+            persist_get_stats(&stats, quiet_str && strcasecmp(quiet_str, "reset") == 0);
+            snprintf(response, sizeof(response),
+                     "\r\nChanges: %d, flash writes: %d, avoided: %d, unchanged: %d, forced: %d\r\n",
+                     (int)stats.marks, (int)stats.writes, (int)(stats.marks - stats.writes),
+                     (int)stats.unchanged, (int)stats.forced);
+            send_response(response);
+        }
+    }
     else
     {
         NRF_LOG_WARNING("Unknown command received: %s", cmd);
@@ -240,6 +623,95 @@ static void send_response(const char *str)
     }
 }
 
+/**
+ * @brief Вывод гистограмм задержки по этапам
+ *
+ * Строка этапа: число трасс, максимум и непустые корзины в виде
+ * <нижняя граница мкс>:<число>.
+ */
+static void send_latency_histograms(void)
+{
+    // Ответ отправляется одной записью: следующая запись CDC ACM до окончания
+    // предыдущей передачи будет отклонена
+    static char report[LATENCY_REPORT_SIZE];
+    int pos = snprintf(report, sizeof(report), "\r\n");
+
+    for (uint8_t stage = LATENCY_STAGE_DEBOUNCE; stage < LATENCY_STAGE_COUNT; ++stage)
+    {
+        latency_histogram histogram;
+        latency_trace_get(stage, &histogram);
+
+        pos += snprintf(report + pos, sizeof(report) - pos, "%-8s n=%d max=%dus",
+                        latency_trace_stage_name(stage), (int)histogram.count, (int)histogram.max_us);
+
+        for (uint8_t bucket = 0; bucket < LATENCY_TRACE_BUCKETS; ++bucket)
+        {
+            if (histogram.buckets[bucket] > 0 && pos < (int)sizeof(report) - 24)
+            {
+                pos += snprintf(report + pos, sizeof(report) - pos, " %lu:%d",
+                                bucket == 0 ? 0UL : 1UL << bucket, histogram.buckets[bucket]);
+            }
+        }
+
+        if (pos < (int)sizeof(report) - 3)
+        {
+            pos += snprintf(report + pos, sizeof(report) - pos, "\r\n");
+        }
+    }
+
+    send_response(report);
+}
+
+/**
+ * @brief Вывод журнала кнопок
+ *
+ * Заголовок содержит текущее время rtc_clock, чтобы отсчитать возраст записей.
+ * Строка записи: <тики RTC hex> <тип><кнопка> <значение>, где тип E - фронт
+ * (значение - уровень), L - уровень после аппаратного антидребезга,
+ * G - жест (значение - индекс шаблона).
+ */
+static void send_button_log(void)
+{
+    static const char type_names[] = {'E', 'L', 'G'};
+    static char report[BTNLOG_REPORT_SIZE];
+    button_log_entry entries[BUTTON_LOG_SIZE];
+    uint8_t count = button_log_read(entries);
+    int pos = snprintf(report, sizeof(report), "\r\nBTNLOG n=%d @%dHz now=%08X\r\n", count, APP_TIMER_CLOCK_FREQ,
+                       (unsigned int)rtc_clock_ticks());
+
+    for (uint8_t i = 0; i < count && pos < (int)sizeof(report); ++i)
+    {
+        pos += snprintf(report + pos, sizeof(report) - pos, "%08X %c%d %d\r\n",
+                        (unsigned int)entries[i].ticks, type_names[entries[i].type],
+                        entries[i].button, entries[i].value);
+    }
+
+    send_response(report);
+}
+
+/**
+ * @brief Вывод непустых пресетов: <номер> <имя> H=<оттенок> S=<насыщенность> V=<яркость>
+ */
+static void send_preset_list(void)
+{
+    static char report[PRESET_REPORT_SIZE];
+    int pos = snprintf(report, sizeof(report), "\r\nPresets:\r\n");
+
+    for (uint32_t i = 0; i < PRESET_COUNT && pos < (int)sizeof(report); ++i)
+    {
+        HSB_color color;
+        const char *name;
+
+        if (preset_get(i, &color, &name))
+        {
+            pos += snprintf(report + pos, sizeof(report) - pos, "%2d %-7s H=%d S=%d V=%d\r\n", (int)i, name,
+                            (int)color.hue, (int)color.saturation, (int)color.brightness);
+        }
+    }
+
+    send_response(report);
+}
+
 /**
  * @brief Инициализация CLI интерфейса
  * 
@@ -0,0 +1,167 @@
+/**
+ * @brief Модуль часов эффектов, синхронизированных с темпом (BPM)
+ *
+ * Позиция в долях вычисляется из счетчика RTC относительно точки привязки,
+ * а не накапливается по кадрам, поэтому не дрейфует и не зависит от того,
+ * насколько поздно был вызван обработчик кадра.
+ */
+
+#include "effect_clock.h"
+#include "rtc_clock.h"
+
+#include "app_timer.h"
+#include "app_util_platform.h"
+
+#include "nrf_log.h"
+
+// Тиков RTC на минуту, деленное на 2^16 / 1000: beats_q16 = ticks * bpm_milli / 30000
+#define EFFECT_CLOCK_TICKS_DIVIDER ((uint64_t)APP_TIMER_CLOCK_FREQ * 60 * 1000 / EFFECT_CLOCK_BEAT_ONE)
+
+#define TAP_INTERVAL_MIN APP_TIMER_TICKS(60000 / EFFECT_CLOCK_BPM_MAX)
+#define TAP_INTERVAL_MAX APP_TIMER_TICKS(60000 / EFFECT_CLOCK_BPM_MIN)
+#define TAP_HISTORY_SIZE 4
+#define TAP_MIN_INTERVALS 3
+
+static uint64_t anchor_ticks = 0;
+static uint32_t anchor_beats = 0;
+static uint32_t bpm_milli = EFFECT_CLOCK_BPM_DEFAULT * 1000;
+
+static uint64_t tap_last_ticks = 0;
+static uint32_t tap_intervals[TAP_HISTORY_SIZE];
+static uint8_t tap_index = 0;
+static uint8_t tap_count = 0;
+// Первый удар после начала сеанса не дает интервала
+static bool tap_restart = false;
+static bool tap_session = false;
+static uint64_t tap_session_ticks = 0;
+
+static uint32_t effect_clock_beats_at(uint64_t ticks)
+{
+    // Удар tap-tempo может быть раньше точки привязки
+    int64_t elapsed = (int64_t)(ticks - anchor_ticks);
+    return anchor_beats + (uint32_t)(elapsed * (int64_t)bpm_milli / (int64_t)EFFECT_CLOCK_TICKS_DIVIDER);
+}
+
+/**
+ * @brief Привязка начала доли к моменту ticks и смена темпа с этого момента
+ */
+static void effect_clock_anchor(uint64_t ticks, uint32_t bpm)
+{
+    CRITICAL_REGION_ENTER();
+    anchor_beats = (effect_clock_beats_at(ticks) + EFFECT_CLOCK_BEAT_ONE / 2) & ~(EFFECT_CLOCK_BEAT_ONE - 1);
+    anchor_ticks = ticks;
+    bpm_milli = bpm;
+    CRITICAL_REGION_EXIT();
+}
+
+void effect_clock_init(void)
+{
+    anchor_ticks = rtc_clock_ticks();
+    anchor_beats = 0;
+}
+
+bool effect_clock_set_bpm(uint32_t bpm)
+{
+    if (bpm < EFFECT_CLOCK_BPM_MIN * 1000 || bpm > EFFECT_CLOCK_BPM_MAX * 1000)
+    {
+        return false;
+    }
+
+    CRITICAL_REGION_ENTER();
+    uint64_t now = rtc_clock_ticks();
+    anchor_beats = effect_clock_beats_at(now);
+    anchor_ticks = now;
+    bpm_milli = bpm;
+    CRITICAL_REGION_EXIT();
+
+    return true;
+}
+
+uint32_t effect_clock_get_bpm(void)
+{
+    return bpm_milli;
+}
+
+void effect_clock_sync(void)
+{
+    effect_clock_anchor(rtc_clock_ticks(), bpm_milli);
+}
+
+void effect_clock_tap(uint64_t ticks)
+{
+    uint64_t interval = ticks - tap_last_ticks;
+    bool restart = tap_restart;
+
+    tap_last_ticks = ticks;
+    tap_restart = false;
+    if (ticks > tap_session_ticks)
+    {
+        tap_session_ticks = ticks;
+    }
+
+    if (restart || interval < TAP_INTERVAL_MIN || interval > TAP_INTERVAL_MAX)
+    {
+        // Слишком длинная пауза или дребезг - начинаем серию заново, интервалы
+        // прежней серии в среднее не попадают
+        tap_count = 0;
+        tap_index = 0;
+        return;
+    }
+
+    tap_intervals[tap_index] = (uint32_t)interval;
+    tap_index = (tap_index + 1) % TAP_HISTORY_SIZE;
+    if (tap_count < TAP_HISTORY_SIZE)
+    {
+        tap_count++;
+    }
+
+    if (tap_count < TAP_MIN_INTERVALS)
+    {
+        return;
+    }
+
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < tap_count; ++i)
+    {
+        sum += tap_intervals[i];
+    }
+
+    uint32_t bpm = (uint32_t)((uint64_t)APP_TIMER_CLOCK_FREQ * 60 * 1000 * tap_count / sum);
+    if (bpm >= EFFECT_CLOCK_BPM_MIN * 1000 && bpm <= EFFECT_CLOCK_BPM_MAX * 1000)
+    {
+        effect_clock_anchor(ticks, bpm);
+        NRF_LOG_INFO("Tap tempo: %d.%03d BPM", bpm / 1000, bpm % 1000);
+    }
+}
+
+void effect_clock_tap_begin(void)
+{
+    tap_count = 0;
+    tap_index = 0;
+    tap_restart = true;
+    tap_session = true;
+    tap_session_ticks = rtc_clock_ticks();
+    NRF_LOG_INFO("Tap tempo: tap the beat");
+}
+
+bool effect_clock_tap_session(void)
+{
+    if (tap_session && rtc_clock_ticks() - tap_session_ticks > TAP_INTERVAL_MAX)
+    {
+        tap_session = false;
+        NRF_LOG_INFO("Tap tempo: %d.%03d BPM", bpm_milli / 1000, bpm_milli % 1000);
+    }
+
+    return tap_session;
+}
+
+uint32_t effect_clock_beats(void)
+{
+    uint32_t beats;
+
+    CRITICAL_REGION_ENTER();
+    beats = effect_clock_beats_at(rtc_clock_ticks());
+    CRITICAL_REGION_EXIT();
+
+    return beats;
+}
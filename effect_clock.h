@@ -0,0 +1,63 @@
+#ifndef EFFECT_CLOCK_H
+#define EFFECT_CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Одна доля в формате Q16 */
+#define EFFECT_CLOCK_BEAT_ONE (1UL << 16)
+
+#define EFFECT_CLOCK_BPM_MIN 20
+#define EFFECT_CLOCK_BPM_MAX 300
+#define EFFECT_CLOCK_BPM_DEFAULT 120
+
+/**
+ * @brief Инициализация часов эффектов (после rtc_clock_init())
+ */
+void effect_clock_init(void);
+
+/**
+ * @brief Установка темпа, фаза текущей доли сохраняется
+ * @param bpm_milli темп в тысячных долях BPM
+ * @return true если темп в допустимом диапазоне
+ */
+bool effect_clock_set_bpm(uint32_t bpm_milli);
+
+/**
+ * @brief Текущий темп в тысячных долях BPM
+ */
+uint32_t effect_clock_get_bpm(void);
+
+/**
+ * @brief Сдвиг фазы: текущий момент становится началом доли
+ */
+void effect_clock_sync(void);
+
+/**
+ * @brief Удар tap-tempo: темп вычисляется по интервалам между ударами
+ *
+ * После смены темпа момент последнего удара становится началом доли, даже
+ * если удар обработан позже.
+ * @param ticks момент удара по часам rtc_clock (фронт нажатия)
+ */
+void effect_clock_tap(uint64_t ticks);
+
+/**
+ * @brief Начало сеанса tap-tempo, удары прежней серии отбрасываются
+ */
+void effect_clock_tap_begin(void);
+
+/**
+ * @brief Проверка сеанса tap-tempo
+ *
+ * Сеанс заканчивается, если после начала или последнего удара прошло больше
+ * интервала самого медленного темпа (EFFECT_CLOCK_BPM_MIN).
+ */
+bool effect_clock_tap_session(void);
+
+/**
+ * @brief Позиция в долях (Q16), младшие 16 бит - фаза внутри доли
+ */
+uint32_t effect_clock_beats(void);
+
+#endif // EFFECT_CLOCK_H
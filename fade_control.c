@@ -0,0 +1,108 @@
+/**
+ * @brief Модуль плавных переходов между наборами значений каналов
+ *
+ * Интерполяция выполняется в фиксированной точке: вес кадра (Q16) считается
+ * один раз на кадр, а на каждый канал приходится одно умножение и сдвиг.
+ */
+
+#include "fade_control.h"
+
+#include <string.h>
+
+/**
+ * @brief Перевод линейного прогресса в вес с учетом кривой перехода
+ * @param t Прогресс в формате Q16 (0..FADE_PROGRESS_ONE)
+ * @return Вес в формате Q16
+ */
+static uint32_t fade_ease(uint32_t t, fade_easing easing)
+{
+    switch (easing)
+    {
+    case FADE_EASING_SMOOTH:
+    {
+        // smoothstep: t^2 * (3 - 2t)
+        uint64_t t2 = ((uint64_t)t * t) >> 16;
+        return (uint32_t)((t2 * (3 * FADE_PROGRESS_ONE - 2 * t)) >> 16);
+    }
+
+    case FADE_EASING_LINEAR:
+    default:
+        return t;
+    }
+}
+
+void fade_start(fade_t *fade, const uint8_t *target, uint16_t frames, fade_easing easing)
+{
+    memcpy(fade->from, fade->out, fade->channels);
+    memcpy(fade->to, target, fade->channels);
+
+    fade->frame = 0;
+    fade->duration = frames;
+    fade->weight_base = 0;
+    fade->easing = easing;
+    fade->active = frames > 0;
+
+    if (!fade->active)
+    {
+        memcpy(fade->out, target, fade->channels);
+    }
+}
+
+void fade_retarget(fade_t *fade, const uint8_t *target)
+{
+    if (memcmp(fade->to, target, fade->channels) == 0)
+    {
+        return;
+    }
+
+    if (!fade->active)
+    {
+        fade_start(fade, target, 0, fade->easing);
+        return;
+    }
+
+    // Время и кривая сохраняются, пройденная часть веса отсчитывается от текущего выхода
+    memcpy(fade->from, fade->out, fade->channels);
+    memcpy(fade->to, target, fade->channels);
+    fade->weight_base = fade_ease(((uint32_t)fade->frame << 16) / fade->duration, fade->easing);
+}
+
+bool fade_step(fade_t *fade)
+{
+    if (!fade->active)
+    {
+        return false;
+    }
+
+    fade->frame++;
+    if (fade->frame >= fade->duration)
+    {
+        memcpy(fade->out, fade->to, fade->channels);
+        fade->active = false;
+        return false;
+    }
+
+    uint32_t progress = ((uint32_t)fade->frame << 16) / fade->duration;
+    uint32_t eased = fade_ease(progress, fade->easing);
+    if (eased < fade->weight_base)
+    {
+        eased = fade->weight_base;
+    }
+
+    // Доля оставшегося после смены цели веса: (w - w0) / (1 - w0)
+    int32_t weight = (int32_t)((((uint64_t)(eased - fade->weight_base)) << 16) /
+                               (FADE_PROGRESS_ONE - fade->weight_base));
+
+    for (uint8_t i = 0; i < fade->channels; ++i)
+    {
+        int32_t delta = (int32_t)fade->to[i] - (int32_t)fade->from[i];
+        fade->out[i] = (uint8_t)(fade->from[i] + ((delta * weight) >> 16));
+    }
+
+    return true;
+}
+
+bool fade_is_active(const fade_t *fade)
+{
+    return fade->active;
+}
@@ -0,0 +1,75 @@
+#ifndef FADE_CONTROL_H
+#define FADE_CONTROL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Единица прогресса перехода в формате Q16 */
+#define FADE_PROGRESS_ONE (1UL << 16)
+
+typedef enum
+{
+    FADE_EASING_LINEAR,
+    FADE_EASING_SMOOTH
+} fade_easing;
+
+typedef struct
+{
+    uint8_t *from;
+    uint8_t *to;
+    uint8_t *out;
+    uint8_t channels;
+    uint16_t frame;
+    uint16_t duration;
+    uint32_t weight_base;   // вес кривой в момент последней смены цели, Q16
+    fade_easing easing;
+    bool active;
+} fade_t;
+
+/**
+ * @brief Объявление перехода с буферами на заданное число каналов
+ */
+#define FADE_DEF(_name, _channels)              \
+    static uint8_t _name##_from[_channels];     \
+    static uint8_t _name##_to[_channels];       \
+    static uint8_t _name##_out[_channels];      \
+    static fade_t _name = {                     \
+        .from = _name##_from,                   \
+        .to = _name##_to,                       \
+        .out = _name##_out,                     \
+        .channels = _channels,                  \
+        .easing = FADE_EASING_LINEAR,           \
+        .active = false}
+
+/**
+ * @brief Запуск перехода к новой цели от текущего выходного значения
+ * @param fade     Переход
+ * @param target   Целевые значения каналов
+ * @param frames   Длительность перехода в кадрах, 0 - мгновенная установка
+ * @param easing   Кривая перехода
+ */
+void fade_start(fade_t *fade, const uint8_t *target, uint16_t frames, fade_easing easing);
+
+/**
+ * @brief Смена цели активного перехода без скачка
+ *
+ * Кривая перехода не начинается заново: от текущего выходного значения к новой
+ * цели проходится оставшаяся часть веса исходной кривой за оставшееся время.
+ * @param fade     Переход
+ * @param target   Новые целевые значения каналов
+ */
+void fade_retarget(fade_t *fade, const uint8_t *target);
+
+/**
+ * @brief Расчет следующего кадра перехода
+ * @param fade Переход
+ * @return true если переход еще продолжается
+ */
+bool fade_step(fade_t *fade);
+
+/**
+ * @brief Проверка активности перехода
+ */
+bool fade_is_active(const fade_t *fade);
+
+#endif // FADE_CONTROL_H
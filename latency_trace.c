@@ -0,0 +1,174 @@
+#include "latency_trace.h"
+
+#include "nrf.h"
+#include "app_util_platform.h"
+
+static const char *stage_names[LATENCY_STAGE_COUNT] = {
+    "edge",
+    "debounce",
+    "dispatch",
+    "update",
+    "display",
+    "pwm"};
+
+static latency_histogram histograms[LATENCY_STAGE_COUNT];
+
+// Следующий ожидаемый этап, LATENCY_STAGE_EDGE - трасса не идет
+static volatile latency_stage trace_next = LATENCY_STAGE_EDGE;
+static uint32_t trace_stamps[LATENCY_STAGE_COUNT];
+// Такт события автомата, от которого считаются этапы после антидребезга
+static uint32_t trace_event;
+// Трасса, ожидавшая жеста до фронта помехи: восстанавливается, если уровень
+// после антидребезга не сменился
+static bool trace_saved = false;
+static uint32_t saved_stamps[LATENCY_STAGE_DISPATCH];
+
+static uint8_t latency_bucket(uint32_t us)
+{
+    uint8_t bucket = 0;
+
+    while (us > 1 && bucket < LATENCY_TRACE_BUCKETS - 1)
+    {
+        us >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+/**
+ * @brief Запись завершенной трассы в гистограммы
+ */
+static void latency_trace_commit(void)
+{
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+
+    for (uint8_t stage = LATENCY_STAGE_DEBOUNCE; stage < LATENCY_STAGE_COUNT; ++stage)
+    {
+        latency_histogram *histogram = &histograms[stage];
+        uint32_t origin = stage == LATENCY_STAGE_DEBOUNCE ? trace_stamps[LATENCY_STAGE_EDGE] : trace_event;
+        uint32_t us = (trace_stamps[stage] - origin) / cycles_per_us;
+        uint8_t bucket = latency_bucket(us);
+
+        histogram->count++;
+        if (us > histogram->max_us)
+        {
+            histogram->max_us = us;
+        }
+        if (histogram->buckets[bucket] < UINT16_MAX)
+        {
+            histogram->buckets[bucket]++;
+        }
+    }
+
+    histograms[LATENCY_STAGE_EDGE].count++;
+}
+
+/**
+ * @brief Метка ожидаемого этапа, вызывается в критической секции
+ */
+static void latency_trace_stamp(latency_stage stage, uint32_t now)
+{
+    trace_stamps[stage] = now;
+    trace_saved = false;
+    if (stage == LATENCY_STAGE_COUNT - 1)
+    {
+        latency_trace_commit();
+        trace_next = LATENCY_STAGE_EDGE;
+    }
+    else
+    {
+        trace_next = stage + 1;
+    }
+}
+
+void latency_trace_mark(latency_stage stage)
+{
+#if LATENCY_TRACE_ENABLED
+    uint32_t now = DWT->CYCCNT;
+
+    CRITICAL_REGION_ENTER();
+    if (stage == LATENCY_STAGE_EDGE)
+    {
+        // Дребезг до окончания антидребезга не сдвигает начало трассы, жест
+        // после диспетчеризации доводится до ШИМ
+        if (trace_next == LATENCY_STAGE_EDGE || trace_next == LATENCY_STAGE_DISPATCH)
+        {
+            trace_saved = trace_next == LATENCY_STAGE_DISPATCH;
+            if (trace_saved)
+            {
+                saved_stamps[LATENCY_STAGE_EDGE] = trace_stamps[LATENCY_STAGE_EDGE];
+                saved_stamps[LATENCY_STAGE_DEBOUNCE] = trace_stamps[LATENCY_STAGE_DEBOUNCE];
+            }
+            trace_stamps[LATENCY_STAGE_EDGE] = now;
+            trace_next = LATENCY_STAGE_DEBOUNCE;
+        }
+    }
+    else if (stage == trace_next)
+    {
+        latency_trace_stamp(stage, now);
+    }
+    CRITICAL_REGION_EXIT();
+#endif
+}
+
+void latency_trace_dispatch(uint32_t event_cycles, uint32_t start_cycles)
+{
+#if LATENCY_TRACE_ENABLED
+    CRITICAL_REGION_ENTER();
+    if (trace_next == LATENCY_STAGE_DISPATCH)
+    {
+        trace_event = event_cycles;
+        latency_trace_stamp(LATENCY_STAGE_DISPATCH, start_cycles);
+    }
+    CRITICAL_REGION_EXIT();
+#endif
+}
+
+void latency_trace_cancel_before(latency_stage stage)
+{
+    CRITICAL_REGION_ENTER();
+    if (trace_next != LATENCY_STAGE_EDGE && trace_next <= stage)
+    {
+        if (trace_saved && trace_next == LATENCY_STAGE_DEBOUNCE)
+        {
+            // Помеха без смены уровня: жест прежней трассы еще впереди
+            trace_stamps[LATENCY_STAGE_EDGE] = saved_stamps[LATENCY_STAGE_EDGE];
+            trace_stamps[LATENCY_STAGE_DEBOUNCE] = saved_stamps[LATENCY_STAGE_DEBOUNCE];
+            trace_next = LATENCY_STAGE_DISPATCH;
+        }
+        else
+        {
+            trace_next = LATENCY_STAGE_EDGE;
+        }
+        trace_saved = false;
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+bool latency_trace_waiting(latency_stage stage)
+{
+    return trace_next == stage;
+}
+
+void latency_trace_get(latency_stage stage, latency_histogram *histogram)
+{
+    CRITICAL_REGION_ENTER();
+    *histogram = histograms[stage];
+    CRITICAL_REGION_EXIT();
+}
+
+void latency_trace_reset(void)
+{
+    CRITICAL_REGION_ENTER();
+    for (uint8_t stage = 0; stage < LATENCY_STAGE_COUNT; ++stage)
+    {
+        histograms[stage] = (latency_histogram){0};
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+const char *latency_trace_stage_name(latency_stage stage)
+{
+    return stage < LATENCY_STAGE_COUNT ? stage_names[stage] : "?";
+}
@@ -0,0 +1,88 @@
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Измерение задержки от фронта кнопки до изменения скважности ШИМ
+ *
+ * Этапы отмечаются по порядку, метка ставится только если предыдущий этап
+ * уже отмечен. Трасса начинается с последнего фронта перед жестом: антидребезг
+ * отмечается на любой смене уровня, диспетчеризация - только когда событие
+ * автомата выполнило действие жеста. Антидребезг считается от фронта,
+ * остальные этапы - от события автомата, породившего жест, поэтому окно
+ * кликов и время удержания в задержку не входят. Время - счетчик тактов DWT,
+ * его включает main().
+ */
+
+// 1 - инструментирование включено
+#ifndef LATENCY_TRACE_ENABLED
+#define LATENCY_TRACE_ENABLED 1
+#endif
+
+// Корзины гистограммы: [0, 2) мкс, затем [2^i, 2^(i+1)) мкс
+#define LATENCY_TRACE_BUCKETS 22
+
+typedef enum
+{
+    LATENCY_STAGE_EDGE,
+    LATENCY_STAGE_DEBOUNCE,
+    LATENCY_STAGE_DISPATCH,
+    LATENCY_STAGE_UPDATE,
+    LATENCY_STAGE_DISPLAY,
+    LATENCY_STAGE_PWM_RELOAD,
+    LATENCY_STAGE_COUNT
+} latency_stage;
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t max_us;
+    uint16_t buckets[LATENCY_TRACE_BUCKETS];
+} latency_histogram;
+
+/**
+ * @brief Отметка этапа
+ *
+ * Фронт начинает новую трассу, если предыдущая ждет жеста или отменена;
+ * повторные фронты дребезга не сдвигают начало трассы, а фронты после
+ * диспетчеризации не прерывают трассу, ожидающую вывода на ШИМ. Трасса,
+ * прерванная помехой без смены уровня, продолжает ждать жеста.
+ */
+void latency_trace_mark(latency_stage stage);
+
+/**
+ * @brief Отметка диспетчеризации жеста
+ * @param event_cycles такт DWT события автомата, породившего жест
+ * @param start_cycles такт DWT начала диспетчеризации
+ */
+void latency_trace_dispatch(uint32_t event_cycles, uint32_t start_cycles);
+
+/**
+ * @brief Отмена трассы, не дошедшей до указанного этапа
+ */
+void latency_trace_cancel_before(latency_stage stage);
+
+/**
+ * @brief Проверка, ожидает ли трасса указанный этап
+ */
+bool latency_trace_waiting(latency_stage stage);
+
+/**
+ * @brief Копия гистограммы этапа
+ */
+void latency_trace_get(latency_stage stage, latency_histogram *histogram);
+
+/**
+ * @brief Сброс гистограмм
+ */
+void latency_trace_reset(void);
+
+/**
+ * @brief Короткое имя этапа для вывода
+ */
+const char *latency_trace_stage_name(latency_stage stage);
+
+#endif // LATENCY_TRACE_H
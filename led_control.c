@@ -1,8 +1,14 @@
 #include "led_control.h"
 #include "pwm_control.h"
 #include "nvmc_control.h"
+#include "persist_policy.h"
+#include "retained_state.h"
+#include "palette_control.h"
+#include "effect_clock.h"
+#include "latency_trace.h"
 
 #include <math.h>
+#include <string.h>
 
 #include "nrfx_pwm.h"
 #include "nrf_gpio.h"
@@ -19,9 +25,37 @@
 #define SATURATION_TOP_VALUE 100
 #define BRIGHTNESS_TOP_VALUE 100
 
+// Сохраненный цвет в одном слове: [оттенок:9][насыщенность:7][яркость:7]
+#define HSB_PACK_HUE_POS 14
+#define HSB_PACK_SATURATION_POS 7
+#define HSB_PACK_FIELD_MASK 0x7F
+#define HSB_PACK_HUE_MASK 0x1FF
+
+#define HUE_STEP 1
 #define SATURATION_STEP 1
 #define BRIGHTNESS_STEP 1
 
+// Ускорение при долгом нажатии: первые RAMP_FINE_MS шаг минимальный, затем
+// за RAMP_ACCEL_MS линейно растет до максимального
+#define RAMP_FINE_MS 1500
+#define RAMP_ACCEL_MS 3000
+#define RAMP_HUE_MAX_STEP 8
+#define RAMP_SB_MAX_STEP 3
+
+#define LED_FADE_DEFAULT_MS 600
+#define LED_FADE_MAX_FRAMES UINT16_MAX
+
+// Относительная яркость каналов (Q8) для компенсации яркости по оттенку:
+// коэффициенты яркости Rec.709 (0.2126, 0.7152, 0.0722)
+#define HUE_LUMA_WEIGHT_R 54
+#define HUE_LUMA_WEIGHT_G 183
+#define HUE_LUMA_WEIGHT_B 18
+#define HUE_LUMA_ONE 256
+#define HUE_DEGREES 360
+
+// Проход палитры за такт из 4 долей: позиция = доли (Q16) >> 10
+#define LED_EFFECT_PALETTE_SHIFT 10
+
 #define LED_TURN_OFF 1
 #define LED_TURN_ON 0
 
@@ -33,8 +67,27 @@ static bool increasing_saturation_LED1 = true;
 
 static uint32_t value_duty_LED1 = 0;
 
+FADE_DEF(rgb_fade, 3);
+static uint16_t fade_duration_frames = LED_FADE_DEFAULT_MS / PWM_FRAME_INTERVAL_MS;
+static fade_easing fade_curve = FADE_EASING_SMOOTH;
+static volatile bool transition_requested = false;
+
+
+static ramp_params ramp = {
+    .fine_ms = RAMP_FINE_MS,
+    .accel_ms = RAMP_ACCEL_MS,
+    .hue_max_step = RAMP_HUE_MAX_STEP,
+    .sb_max_step = RAMP_SB_MAX_STEP};
+
+static volatile led_effect current_effect = LED_EFFECT_NONE;
+
+static uint16_t hue_luma_table[HUE_DEGREES];
+static bool hue_luma_compensation = false;
+
 static void hsv_to_rgb_float();
 static void change_value_smoothly(uint32_t *value, bool *increasing, uint32_t min_value, uint32_t max_value, uint32_t step);
+static persist_result blinky_save_data(void);
+static void led_state_changed(void);
 
 controller_mode current_mode = MODE_AFK;
 
@@ -65,17 +118,87 @@ HSB_color HSB_save = {
     .saturation = SATURATION_TOP_VALUE,
     .brightness = BRIGHTNESS_TOP_VALUE};
 
+uint32_t led_hsb_pack(const HSB_color *color)
+{
+    return ((color->hue % 360) << HSB_PACK_HUE_POS) |
+           ((color->saturation & HSB_PACK_FIELD_MASK) << HSB_PACK_SATURATION_POS) |
+           (color->brightness & HSB_PACK_FIELD_MASK);
+}
+
+bool led_hsb_unpack(uint32_t packed, HSB_color *color)
+{
+    HSB_color unpacked = {
+        .hue = (packed >> HSB_PACK_HUE_POS) & HSB_PACK_HUE_MASK,
+        .saturation = (packed >> HSB_PACK_SATURATION_POS) & HSB_PACK_FIELD_MASK,
+        .brightness = packed & HSB_PACK_FIELD_MASK};
+
+    // Поля шире допустимых значений: выход за диапазон - не цвет, а мусор
+    if (unpacked.hue >= 360 || unpacked.saturation > SATURATION_TOP_VALUE ||
+        unpacked.brightness > BRIGHTNESS_TOP_VALUE)
+    {
+        return false;
+    }
+
+    *color = unpacked;
+    return true;
+}
+
+// Цвет восстановлен из RAM до инициализации, флеш его не заменяет
+static bool state_retained = false;
+
+bool led_restore_retained(void)
+{
+    HSB_color color;
+
+    if (!retained_state_restore(&color))
+    {
+        return false;
+    }
+
+    HSB_current_state = color;
+    state_retained = true;
+    return true;
+}
+
 void init_state_RGB(void)
 {
-    HSB_current_state = HSB_save;
-    uint32_t read = nvmc_read_last_data((uint32_t *)&(HSB_save));
-    if (read > 0)
+    uint32_t packed;
+
+    if (!nvmc_read_packed(NVMC_PACKED_KEY_COLOR, &packed) || !led_hsb_unpack(packed, &HSB_save))
+    {
+        NRF_LOG_WARNING("No intact settings record, using defaults");
+    }
+
+    persist_init(blinky_save_data);
+
+    if (!state_retained)
     {
         HSB_current_state = HSB_save;
+        retained_state_store(&HSB_current_state);
     }
+    else if (memcmp(&HSB_current_state, &HSB_save, sizeof(HSB_color)) != 0)
+    {
+        // Изменения, не сохраненные до сброса, сохраняются по общей политике
+        NRF_LOG_INFO("Color restored from RAM, flash copy is older");
+        persist_mark_dirty();
+    }
+}
+
+/**
+ * @brief Изменение цвета: обновление копии в RAM и отметка для сохранения
+ */
+static void led_state_changed(void)
+{
+    retained_state_store(&HSB_current_state);
+    persist_mark_dirty();
+}
+
+static void blinky_save_done(nvmc_packed_key key)
+{
+    NRF_LOG_INFO("End save data");
 }
 
-static void blinky_save_data(void)
+static persist_result blinky_save_data(void)
 {
 
     NRF_LOG_INFO("Start save data");
@@ -87,53 +210,75 @@ static void blinky_save_data(void)
         NRF_LOG_INFO("CURRENT STATE -> Hue: %d; Saturation: %d; Brightness: %d", HSB_current_state.hue, HSB_current_state.saturation, HSB_current_state.brightness);
         NRF_LOG_INFO("SAVE STATE -> Hue: %d; Saturation: %d; Brightness: %d", HSB_save.hue, HSB_save.saturation, HSB_save.brightness);
         NRF_LOG_INFO("Nothing save");
-        return;
+        return PERSIST_UNCHANGED;
     }
 
-    nvmc_write_data((uint32_t *)&(HSB_current_state));
-    while (!nvmc_write_complete_check()) // можно убрать
+    if (!nvmc_write_packed_async(NVMC_PACKED_KEY_COLOR, led_hsb_pack(&HSB_current_state), blinky_save_done))
     {
+        NRF_LOG_WARNING("Save queue full");
+        return PERSIST_RETRY;
     }
 
-    NRF_LOG_INFO("End save data");
     HSB_save = HSB_current_state;
 
     NRF_LOG_INFO("CURRENT STATE -> Hue: %d; Saturation: %d; Brightness: %d", HSB_current_state.hue, HSB_current_state.saturation, HSB_current_state.brightness);
     NRF_LOG_INFO("NEW SAVE STATE -> Hue: %d; Saturation: %d; Brightness: %d", HSB_save.hue, HSB_save.saturation, HSB_save.brightness);
+    return PERSIST_WRITTEN;
 }
 
 void set_current_mode(void)
 {
     current_mode = (current_mode + 1) % 4;
     NRF_LOG_INFO("Current mode: %s", controller_mode_strings[(int)current_mode]);
-    if (current_mode == MODE_AFK)
+}
+
+/**
+ * @brief Шаг изменения значения в зависимости от времени удержания кнопки
+ * @param hold_ms время удержания в мс
+ * @param fine_step шаг в начале удержания
+ * @param max_step шаг после полного разгона
+ */
+static uint32_t ramp_step(uint32_t hold_ms, uint32_t fine_step, uint32_t max_step)
+{
+    if (hold_ms <= ramp.fine_ms || max_step <= fine_step)
+    {
+        return fine_step;
+    }
+
+    uint32_t accel_time = hold_ms - ramp.fine_ms;
+    if (ramp.accel_ms == 0 || accel_time >= ramp.accel_ms)
     {
-        blinky_save_data();
+        return max_step;
     }
+
+    return fine_step + (max_step - fine_step) * accel_time / ramp.accel_ms;
 }
 
-void update_value_HSB(void)
+void update_value_HSB(uint32_t hold_ms)
 {
-
     NRF_LOG_INFO("Hue: %d; Saturation: %d; Brightness: %d", HSB_current_state.hue, HSB_current_state.saturation, HSB_current_state.brightness);
 
     switch (current_mode)
     {
     case MODE_HUE:
-        HSB_current_state.hue = (HSB_current_state.hue + 1) % 360;
+        HSB_current_state.hue = (HSB_current_state.hue + ramp_step(hold_ms, HUE_STEP, ramp.hue_max_step)) % 360;
         break;
 
     case MODE_SATURATION:
-        change_value_smoothly(&HSB_current_state.saturation, &increasing_saturation, 0, SATURATION_TOP_VALUE, SATURATION_STEP);
+        change_value_smoothly(&HSB_current_state.saturation, &increasing_saturation, 0, SATURATION_TOP_VALUE,
+                              ramp_step(hold_ms, SATURATION_STEP, ramp.sb_max_step));
         break;
 
     case MODE_BRIGHTNESS:
-        change_value_smoothly(&HSB_current_state.brightness, &increasing_brightness, 0, BRIGHTNESS_TOP_VALUE, BRIGHTNESS_STEP);
+        change_value_smoothly(&HSB_current_state.brightness, &increasing_brightness, 0, BRIGHTNESS_TOP_VALUE,
+                              ramp_step(hold_ms, BRIGHTNESS_STEP, ramp.sb_max_step));
         break;
 
     default:
-        break;
+        return;
     }
+
+    led_state_changed();
 }
 
 void update_value_LED1(void)
@@ -176,12 +321,16 @@ static void change_value_smoothly(uint32_t *value, bool *increasing, uint32_t mi
     }
     else
     {
-        (*value) -= step;
-        if (*value <= min_value)
+        // Проверка до вычитания: при шаге больше 1 значение не должно уйти ниже нуля
+        if (*value <= min_value + step)
         {
             *value = min_value;
             *increasing = true;
         }
+        else
+        {
+            (*value) -= step;
+        }
     }
 }
 
@@ -235,19 +384,150 @@ static void hsv_to_rgb_float()
         b_prime = x;
     }
 
+    if (hue_luma_compensation)
+    {
+        // Масштабируем только хроматическую часть, белая составляющая m не зависит от оттенка
+        float k = hue_luma_table[(uint32_t)hue] / (float)HUE_LUMA_ONE;
+        r_prime *= k;
+        g_prime *= k;
+        b_prime *= k;
+    }
+
     RGB.red = (uint8_t)((r_prime + m) * 255);
     RGB.green = (uint8_t)((g_prime + m) * 255);
     RGB.blue = (uint8_t)((b_prime + m) * 255);
 }
 
+void led_hue_luma_init(void)
+{
+    float luma[HUE_DEGREES];
+    float luma_min = 1.0f;
+
+    for (uint32_t hue = 0; hue < HUE_DEGREES; ++hue)
+    {
+        // Чистый оттенок: один канал 1, второй x, третий 0
+        float x = 1 - fabsf(fmodf(hue / 60.0f, 2) - 1);
+        float r = 0, g = 0, b = 0;
+
+        switch (hue / 60)
+        {
+        case 0:
+            r = 1;
+            g = x;
+            break;
+
+        case 1:
+            r = x;
+            g = 1;
+            break;
+
+        case 2:
+            g = 1;
+            b = x;
+            break;
+
+        case 3:
+            g = x;
+            b = 1;
+            break;
+
+        case 4:
+            r = x;
+            b = 1;
+            break;
+
+        default:
+            r = 1;
+            b = x;
+            break;
+        }
+
+        luma[hue] = (r * HUE_LUMA_WEIGHT_R + g * HUE_LUMA_WEIGHT_G + b * HUE_LUMA_WEIGHT_B) / HUE_LUMA_ONE;
+        if (luma[hue] < luma_min)
+        {
+            luma_min = luma[hue];
+        }
+    }
+
+    for (uint32_t hue = 0; hue < HUE_DEGREES; ++hue)
+    {
+        hue_luma_table[hue] = (uint16_t)(luma_min / luma[hue] * HUE_LUMA_ONE + 0.5f);
+    }
+}
+
+void led_set_hue_luma_compensation(bool enabled)
+{
+    hue_luma_compensation = enabled;
+}
+
+/**
+ * @brief Продвижение перехода к цвету из HSB_current_state
+ *
+ * Новый цвет из CLI запускает переход заданной длительности, изменения кнопкой
+ * во время перехода только сдвигают цель, без скачка выходного значения.
+ */
+static void led_update_transition(void)
+{
+    const uint8_t target[] = {RGB.red, RGB.green, RGB.blue};
+
+    if (transition_requested)
+    {
+        transition_requested = false;
+        fade_start(&rgb_fade, target, fade_duration_frames, fade_curve);
+    }
+    else
+    {
+        fade_retarget(&rgb_fade, target);
+    }
+
+    fade_step(&rgb_fade);
+}
+
+/**
+ * @brief Применение эффекта к цвету кадра по фазе часов эффектов
+ */
+static void led_apply_effect(void)
+{
+    if (current_effect == LED_EFFECT_NONE)
+    {
+        return;
+    }
+
+    uint32_t beats = effect_clock_beats();
+
+    switch (current_effect)
+    {
+    case LED_EFFECT_PALETTE:
+        RGB = palette_sample((uint8_t)(beats >> LED_EFFECT_PALETTE_SHIFT));
+        break;
+
+    case LED_EFFECT_PULSE:
+    {
+        // Огибающая спадает от 256 до 1 за долю
+        uint32_t envelope = 256 - ((beats & (EFFECT_CLOCK_BEAT_ONE - 1)) >> 8);
+        RGB.red = (uint8_t)((RGB.red * envelope) >> 8);
+        RGB.green = (uint8_t)((RGB.green * envelope) >> 8);
+        RGB.blue = (uint8_t)((RGB.blue * envelope) >> 8);
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
 void led_display_current_color(void)
 {
     hsv_to_rgb_float();
+    led_apply_effect();
+    led_update_transition();
 
     pwm_update_duty_cycle(0, value_duty_LED1);
-    pwm_update_duty_cycle(1, RGB.red);
-    pwm_update_duty_cycle(2, RGB.green);
-    pwm_update_duty_cycle(3, RGB.blue);
+    pwm_update_duty_cycle(1, rgb_fade.out[0]);
+    pwm_update_duty_cycle(2, rgb_fade.out[1]);
+    pwm_update_duty_cycle(3, rgb_fade.out[2]);
+
+    latency_trace_mark(LATENCY_STAGE_DISPLAY);
 }
 
 void init_led_pin(void)
@@ -338,6 +618,8 @@ void led_set_rgb_color(uint8_t red, uint8_t green, uint8_t blue)
     HSB_current_state.hue = h;
     HSB_current_state.saturation = s;
     HSB_current_state.brightness = v;
+    transition_requested = true;
+    led_state_changed();
 }
 
 void led_set_hsv_color(uint32_t hue, uint32_t saturation, uint32_t value)
@@ -345,4 +627,36 @@ void led_set_hsv_color(uint32_t hue, uint32_t saturation, uint32_t value)
     HSB_current_state.hue = hue;
     HSB_current_state.saturation = saturation;
     HSB_current_state.brightness = value;
+    transition_requested = true;
+    led_state_changed();
+}
+
+HSB_color led_get_hsv_color(void)
+{
+    return HSB_current_state;
+}
+
+void led_set_ramp(const ramp_params *params)
+{
+    ramp = *params;
+}
+
+void led_set_effect(led_effect effect)
+{
+    current_effect = effect;
+    transition_requested = true;
+}
+
+void led_next_effect(void)
+{
+    led_set_effect((current_effect + 1) % (LED_EFFECT_PULSE + 1));
+    NRF_LOG_INFO("Effect: %d", current_effect);
+}
+
+void led_set_fade(uint32_t duration_ms, fade_easing easing)
+{
+    uint32_t frames = duration_ms / PWM_FRAME_INTERVAL_MS;
+
+    fade_duration_frames = frames > LED_FADE_MAX_FRAMES ? LED_FADE_MAX_FRAMES : frames;
+    fade_curve = easing;
 }
@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "fade_control.h"
+
 #define LED_PIN NRF_GPIO_PIN_MAP(0, 6)
 #define LED_R_PIN NRF_GPIO_PIN_MAP(0, 8)
 #define LED_G_PIN NRF_GPIO_PIN_MAP(1, 9)
@@ -18,6 +20,13 @@ typedef enum
     MODE_BRIGHTNESS
 } controller_mode;
 
+typedef enum
+{
+    LED_EFFECT_NONE,
+    LED_EFFECT_PALETTE,
+    LED_EFFECT_PULSE
+} led_effect;
+
 typedef struct
 {
     uint16_t afk_const;
@@ -26,6 +35,14 @@ typedef struct
     uint16_t brightness_const;
 } mode_steps;
 
+typedef struct
+{
+    uint16_t fine_ms;
+    uint16_t accel_ms;
+    uint8_t hue_max_step;
+    uint8_t sb_max_step;
+} ramp_params;
+
 typedef struct
 {
     uint8_t red;
@@ -41,7 +58,11 @@ typedef struct
 } HSB_color;
 
 void set_current_mode(void);
-void update_value_HSB(void);
+/**
+ * @brief Изменение параметра текущего режима при долгом нажатии
+ * @param hold_ms время удержания кнопки в мс, определяет шаг изменения
+ */
+void update_value_HSB(uint32_t hold_ms);
 void update_value_LED1(void);
 void led_display_current_color(void);
 
@@ -50,8 +71,29 @@ void turn_on_led(int pin);
 void turn_off_led(int pin);
 void turn_off_all_leds(void);
 
+/**
+ * @brief Восстановление цвета из RAM после сброса без отключения питания
+ *
+ * Вызывается первым при запуске, до логов и USB. Если цвет восстановлен,
+ * init_state_RGB() не заменяет его сохраненным во флеш.
+ * @return true если цвет восстановлен
+ */
+bool led_restore_retained(void);
+
 void init_state_RGB(void);
 
+/**
+ * @brief Расчет таблицы компенсации яркости по оттенку
+ */
+void led_hue_luma_init(void);
+
+/**
+ * @brief Включение постоянной яркости при смене оттенка
+ * @param enabled true - яркость чистых оттенков выравнивается по таблице до
+ * яркости синего: зеленый ослабляется примерно до 10%, желтый до 8%
+ */
+void led_set_hue_luma_compensation(bool enabled);
+
 /**
  * @brief Установка цвета в формате RGB
  * @param red значение красного (0-255)
@@ -68,4 +110,45 @@ void led_set_rgb_color(uint8_t red, uint8_t green, uint8_t blue);
  */
 void led_set_hsv_color(uint32_t hue, uint32_t saturation, uint32_t value);
 
+/**
+ * @brief Текущий (целевой) цвет в формате HSV
+ */
+HSB_color led_get_hsv_color(void);
+
+/**
+ * @brief Упаковка цвета в 23 бита: [оттенок:9][насыщенность:7][яркость:7]
+ */
+uint32_t led_hsb_pack(const HSB_color *color);
+
+/**
+ * @brief Распаковка цвета, упакованного led_hsb_pack()
+ * @return false если поля вне диапазона цвета, color не меняется
+ */
+bool led_hsb_unpack(uint32_t packed, HSB_color *color);
+
+/**
+ * @brief Настройка плавного перехода при смене цвета
+ * @param duration_ms длительность перехода в мс (0 - мгновенная смена)
+ * @param easing кривая перехода
+ */
+void led_set_fade(uint32_t duration_ms, fade_easing easing);
+
+/**
+ * @brief Настройка ускорения изменения значений при долгом нажатии
+ * @param params время точной настройки, время разгона и максимальные шаги
+ */
+void led_set_ramp(const ramp_params *params);
+
+/**
+ * @brief Выбор эффекта, синхронизированного с темпом
+ * @param effect LED_EFFECT_PALETTE - проход палитры за такт,
+ *               LED_EFFECT_PULSE - затухание текущего цвета на каждой доле
+ */
+void led_set_effect(led_effect effect);
+
+/**
+ * @brief Переключение на следующий эффект по кругу
+ */
+void led_next_effect(void);
+
 #endif // LED_CONTROL_H
@@ -5,8 +5,15 @@
 #include "pwm_control.h"
 #include "button_handler.h"
 
+#include "palette_control.h"
 #include "nvmc_control.h"
+#include "persist_policy.h"
+#include "preset_bank.h"
+#include "effect_clock.h"
+#include "latency_trace.h"
+#include "rtc_clock.h"
 
+#include "nrf.h"
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
 #include "nrf_log_default_backends.h"
@@ -15,44 +22,124 @@
 #include "app_usbd_serial_num.h"
 #include "cli_control.h"
 
+void init_cycle_counter(void);
 void init_logs(void);
 void init_helper(void);
 
-void blinky_on_button_click(void)
+void blinky_on_button_press(void)
 {
+    if (effect_clock_tap_session())
+    {
+        effect_clock_tap(button_press_ticks());
+    }
 }
 
 void blinky_on_button_double_click(void)
 {
-    set_current_mode();
+    if (!effect_clock_tap_session())
+    {
+        set_current_mode();
+    }
+}
+
+void blinky_on_button_triple_click(void)
+{
+    if (!effect_clock_tap_session())
+    {
+        led_next_effect();
+    }
 }
 
 void blinky_on_button_long_press(void)
 {
-    update_value_HSB();
+    if (!effect_clock_tap_session())
+    {
+        update_value_HSB(button_hold_time_ms());
+    }
 }
 
+void blinky_on_button_click_hold(void)
+{
+    if (!effect_clock_tap_session())
+    {
+        preset_next();
+    }
+}
+
+void blinky_on_button_tap_tempo(void)
+{
+    effect_clock_tap_begin();
+}
+
+// Tap tempo - отдельный сеанс: тройной клик с удержанием начинает его, затем
+// каждое нажатие - удар с меткой времени фронта. Во время сеанса остальные
+// жесты не выполняются, поэтому удары любого темпа из диапазона
+// EFFECT_CLOCK_BPM_MIN..MAX не превращаются в двойной и тройной клик.
+static const gesture_pattern blinky_gestures[] = {
+    {.presses = 0, .flags = GESTURE_FLAG_IMMEDIATE, .action = blinky_on_button_press},
+    {.presses = 2, .action = blinky_on_button_double_click},
+    {.presses = 3, .action = blinky_on_button_triple_click},
+    {.presses = 1, .hold_ms = 1000, .flags = GESTURE_FLAG_REPEAT, .action = blinky_on_button_long_press},
+    {.presses = 2, .hold_ms = 1000, .action = blinky_on_button_click_hold},
+    {.presses = 3, .hold_ms = 1000, .action = blinky_on_button_tap_tempo},
+};
+
+static const button_config_t blinky_buttons[] = {
+    {.pin = BUTTON_PIN, .gestures = blinky_gestures, .gesture_count = sizeof(blinky_gestures) / sizeof(blinky_gestures[0])},
+};
+
 int main(void)
 {
+    init_cycle_counter();
+
+    // После мягкого сброса цвет из RAM выводится до медленной инициализации логов и USB
+    pwm_controller_init();
+    bool retained = led_restore_retained();
+    if (retained)
+    {
+        led_display_current_color();
+        pwm_start_playback();
+    }
+
     init_logs();
-    NRF_LOG_INFO("Starting the main application");
+    NRF_LOG_INFO("Starting the main application%s", retained ? ", color restored from RAM" : "");
 
     init_helper();
 
-    turn_off_all_leds();
-
-    pwm_start_playback();
+    if (!retained)
+    {
+        turn_off_all_leds();
+        pwm_start_playback();
+    }
     pwm_timer_start();
 
     while (true)
     {
+        button_process();
         cli_process();
+        persist_process();
+        bool storage_busy = nvmc_process();
         LOG_BACKEND_USB_PROCESS();
         NRF_LOG_PROCESS();
-        __WFI();
+
+        // Пока идет запись во флеш, шаги автомата выполняются без сна
+        if (!storage_busy)
+        {
+            __WFI();
+        }
     }
 }
 
+/**
+ * @brief Счетчик тактов DWT, по которому измеряются прерывания кнопок,
+ * трасса задержки и операции с флеш
+ */
+void init_cycle_counter(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
 void init_logs(void)
 {
     ret_code_t ret = NRF_LOG_INIT(NULL);
@@ -63,12 +150,18 @@ void init_logs(void)
 
 void init_helper(void)
 {
-    button_init(blinky_on_button_click, blinky_on_button_double_click, blinky_on_button_long_press);
+    rtc_clock_init();
 
-    pwm_controller_init();
+    button_init(blinky_buttons, sizeof(blinky_buttons) / sizeof(blinky_buttons[0]));
+
+    effect_clock_init();
 
     cli_init();
 
-    nvmc_initialize(sizeof(HSB_color));
+    led_hue_luma_init();
+
+    nvmc_initialize();
     init_state_RGB();
+    palette_init();
+    preset_init();
 }
\ No newline at end of file
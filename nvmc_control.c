@@ -1,29 +1,198 @@
 #include "nvmc_control.h"
 
+#include <string.h>
+
+#include "nrf.h"
 #include "nrfx_nvmc.h"
 #include "nrf_bootloader_info.h"
 #include "nrf_dfu_types.h"
 
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "crc32.h"
 #include "nrf_log.h"
 
+// Переопределяется при сборке на хосте, где область данных эмулируется
+// файлом, отображенным в память по 32-битному адресу
+#ifndef NVMC_BOOTLOADER_START_ADDR
 #define NVMC_BOOTLOADER_START_ADDR (0xE0000)
-#define NVMC_PAGE_SIZE (0x1000)
+#endif
+// Учет чтений флеш эмулятором при сборке на хосте
+#ifndef NVMC_READ_HOOK
+#define NVMC_READ_HOOK(addr)
+#endif
 #define NVMC_PAGE_START (NVMC_BOOTLOADER_START_ADDR - NRF_DFU_APP_DATA_AREA_SIZE)
 #define NVMC_EMPTY_VALUE 0xFFFFFFFF
 #define NVMC_WORD_SIZE (sizeof(uint32_t))
+#define NVMC_PAGE_WORDS (NVMC_PAGE_SIZE / NVMC_WORD_SIZE)
+
+// Заголовок страницы журнала: признак формата и номер страницы в порядке записи
+#define NVMC_PAGE_MAGIC 0x34474F4C
+#define NVMC_PAGE_HEADER_WORDS 2
+#define NVMC_NO_PAGE 0xFF
+
+// Запись журнала: [1][ключ:15][размер в словах:16][номер][данные][CRC32][подтверждение].
+// CRC считается по заголовку, номеру и данным. Подтверждение записывается
+// последним, запись без него или с неверной CRC при загрузке пропускается.
+// Старший бит заголовка всегда 1: недописанный заголовок сохраняет его и
+// не может быть принят за упакованное слово
+#define NVMC_RECORD_FLAG (1UL << 31)
+#define NVMC_RECORD_COMMIT 0x54494D43
+#define NVMC_RECORD_OVERHEAD_WORDS 4
+#define NVMC_RECORD_HEADER(key, words) (NVMC_RECORD_FLAG | ((uint32_t)(key) << 16) | (words))
+#define NVMC_RECORD_KEY(header) (((header) >> 16) & 0x7FFF)
+#define NVMC_RECORD_DATA_WORDS(header) ((header) & 0xFFFF)
+
+// Упакованная запись в одно слово: [0][ключ:3][проверка:5][значение:23].
+// Проверка - число нулевых бит ключа и значения (код Бергера). Недописанное
+// слово может только сохранить лишние единицы: нулей в данных становится
+// меньше, а поле проверки может только вырасти, поэтому такое слово всегда
+// отбрасывается, а с несброшенным старшим битом читается как поврежденный
+// заголовок. Слово само служит подтверждением, номер записи не нужен:
+// порядок задают положение в журнале и номер страницы
+#define NVMC_PACKED_KEY_POS 28
+#define NVMC_PACKED_CHECK_POS 23
+#define NVMC_PACKED_CHECK_MASK 0x1F
+#define NVMC_PACKED_INFO_MASK ((0x7UL << NVMC_PACKED_KEY_POS) | NVMC_PACKED_VALUE_MAX)
+#define NVMC_PACKED_INFO_BITS 26
+#define NVMC_PACKED_KEY(word) (((word) >> NVMC_PACKED_KEY_POS) & 0x7)
+
+// Каталог страницы - по слову на каждые NVMC_SEGMENT_WORDS слов страницы:
+// [0][смещение:7][маска ключей:24]. Маска - ключи дописанных записей, начатых
+// в сегменте (упакованные после обычных), смещение - начало первой записи
+// следующего сегмента, в который может заходить последняя запись. Слово
+// пишется перед первой записью за концом сегмента, поэтому записанные слова
+// каталога идут подряд и конец журнала страницы находится двоичным поиском
+// по каталогу. Старший бит 0: слово каталога не бывает стертым. Недописанное
+// слово сохраняет лишние единицы: лишний ключ в маске стоит одного обхода
+// сегмента, а большее смещение только пропускает стертые слова
+#define NVMC_SEGMENT_COUNT (NVMC_PAGE_WORDS / NVMC_SEGMENT_WORDS)
+#define NVMC_DATA_START_WORDS (NVMC_PAGE_HEADER_WORDS + NVMC_SEGMENT_COUNT)
+#define NVMC_DIRECTORY_OFFSET_POS 24
+#define NVMC_DIRECTORY_WORD(keys, offset) ((keys) | ((uint32_t)(offset) << NVMC_DIRECTORY_OFFSET_POS))
+#define NVMC_DIRECTORY_OFFSET(word) (((word) >> NVMC_DIRECTORY_OFFSET_POS) & 0x7F)
+#define NVMC_KEY_SLOTS (NVMC_MAX_KEYS + NVMC_PACKED_MAX_KEYS)
+#define NVMC_ALL_KEYS ((1UL << NVMC_KEY_SLOTS) - 1)
+
+STATIC_ASSERT(NVMC_KEY_SLOTS <= NVMC_DIRECTORY_OFFSET_POS);
+STATIC_ASSERT(NVMC_SEGMENT_WORDS <= 0x80 && NVMC_PAGE_WORDS % NVMC_SEGMENT_WORDS == 0);
+
+// Живые записи переносятся сборкой мусора в текущую страницу, которая после
+// сбоя питания во время сборки может быть уже заполнена ими же
+STATIC_ASSERT(NVMC_MAX_KEYS * (NVMC_MAX_RECORD_SIZE / 4 + NVMC_RECORD_OVERHEAD_WORDS) + NVMC_PACKED_MAX_KEYS <=
+              (NVMC_PAGE_WORDS - NVMC_DATA_START_WORDS) / 2);
+STATIC_ASSERT(NVMC_PAGE_COUNT >= 2);
+
+// Длительность одного шага стирания; на это время процессор останавливается.
+// Для nRF52840 1-2 мс; меньше - больше шагов и время стирания всей страницы
+#ifndef NVMC_ERASE_SLICE_MS
+#define NVMC_ERASE_SLICE_MS 2
+#endif
+
+#define NVMC_QUEUE_SIZE 4
+
+typedef enum
+{
+    NVMC_PAGE_BLANK,    // стерта, готова стать текущей
+    NVMC_PAGE_LOG,      // страница журнала
+    NVMC_PAGE_DIRTY     // чужие или поврежденные данные, стирается без переноса
+} nvmc_page_state;
+
+typedef enum
+{
+    NVMC_STATE_IDLE,
+    NVMC_STATE_ERASE,
+    NVMC_STATE_HEADER,
+    NVMC_STATE_DIRECTORY,
+    NVMC_STATE_DATA,
+    NVMC_STATE_COMMIT
+} nvmc_state;
 
-// Структура контекста
 typedef struct
 {
-    bool erase_needed;
-    uint32_t writable_block_size;
-    uint32_t *current_address;
-} nvmc_context_t;
+    uint8_t key;        // nvmc_key или nvmc_packed_key по признаку packed
+    uint16_t words;
+    bool packed;
+    union
+    {
+        nvmc_write_callback record;
+        nvmc_packed_write_callback packed;
+    } callback;
+    uint32_t data[NVMC_MAX_RECORD_SIZE / sizeof(uint32_t)];
+} nvmc_request;
+
+// Индекс: адрес последней целой записи каждого ключа, строится при загрузке.
+// Упакованные значения индексируются отдельно, их ключи не пересекаются с обычными
+static uint32_t *nvmc_index[NVMC_MAX_KEYS];
+static uint32_t *nvmc_packed_index[NVMC_PACKED_MAX_KEYS];
+
+// Записи ключей, найденные обходом одного сегмента
+typedef struct
+{
+    uint32_t *latest[NVMC_KEY_SLOTS];   // последняя дописанная, для упакованных - целая
+    uint32_t *previous[NVMC_MAX_KEYS];  // дописанная перед последней
+    uint32_t keys;                      // маска ключей для каталога
+} nvmc_segment_records;
+
+static uint8_t nvmc_page_states[NVMC_PAGE_COUNT];
+static uint32_t nvmc_page_sequences[NVMC_PAGE_COUNT];
+
+static uint8_t nvmc_active_page = NVMC_NO_PAGE;
+static uint32_t *nvmc_write_address = NULL;
+static uint32_t nvmc_next_page_sequence = 0;
+static uint32_t nvmc_next_sequence = 0;
+
+// Первое незаписанное слово каталога текущей страницы и ключи записей его сегмента
+static uint8_t nvmc_directory_next = 0;
+static uint32_t nvmc_segment_keys = 0;
+
+// Страница, живые записи которой переносятся перед стиранием
+static uint8_t nvmc_gc_page = NVMC_NO_PAGE;
 
-static nvmc_context_t nvmc_context = {
-    .erase_needed = false,
-    .current_address = NULL,
-    .writable_block_size = 0};
+// Очередь записей: добавление из любого контекста, обработка в nvmc_process()
+static nvmc_request nvmc_queue[NVMC_QUEUE_SIZE];
+static volatile uint8_t nvmc_queue_head = 0;
+static volatile uint8_t nvmc_queue_count = 0;
+
+// Текущая операция автомата записи
+static struct
+{
+    nvmc_state state;
+    uint8_t page;
+    uint8_t segment;        // сегмент начала записи, NVMC_SEGMENT_COUNT - новая страница
+    bool relocation;        // перенос записи сборкой мусора, а не запись из очереди
+    bool packed;            // запись в одно слово, source указывает на готовое слово
+    uint8_t key;
+    uint16_t words;
+    const uint32_t *source;
+    uint32_t *record;
+    uint32_t index;
+    uint32_t sequence;
+} nvmc_job = {.state = NVMC_STATE_IDLE};
+
+// Наибольшие длительности в тактах DWT, переводятся в мкс в nvmc_get_stats()
+static struct
+{
+    uint32_t max_step_cycles;
+    uint32_t max_write_cycles;
+    uint32_t max_erase_cycles;
+    uint32_t erase_slices;
+    uint32_t words_written;
+} nvmc_timing;
+
+/**
+ * @brief Обновление максимума длительности операции
+ * @param max_cycles максимум для этой операции
+ * @param start      значение DWT->CYCCNT перед операцией
+ */
+static void nvmc_measure(uint32_t *max_cycles, uint32_t start)
+{
+    uint32_t cycles = DWT->CYCCNT - start;
+    if (cycles > *max_cycles)
+    {
+        *max_cycles = cycles;
+    }
+}
 
 /**
  * @brief Чтение одного слова из памяти
@@ -32,6 +201,7 @@ static nvmc_context_t nvmc_context = {
  */
 static void nvmc_read_word(uint32_t *addr, uint32_t *data)
 {
+    NVMC_READ_HOOK(addr);
     *data = *addr;
 }
 
@@ -42,106 +212,824 @@ static void nvmc_read_word(uint32_t *addr, uint32_t *data)
  */
 static void nvmc_write_word(uint32_t *addr, uint32_t data)
 {
-    nrfx_nvmc_word_write((uint32_t)addr, data);
+    uint32_t start = DWT->CYCCNT;
+
+    nrfx_nvmc_word_write((uint32_t)(uintptr_t)addr, data);
+    nvmc_measure(&nvmc_timing.max_write_cycles, start);
+    nvmc_timing.words_written++;
 }
 
 /**
- * @brief Стирание страницы памяти
+ * @brief Начало стирания страницы памяти по частям
  * @param page_start_addr Адрес начала страницы
- * @return NRFX_SUCCESS если стирание успешно, иначе код ошибки
+ * @return NRFX_SUCCESS если стирание начато, иначе код ошибки
+ */
+static nrfx_err_t nvmc_erase_page_start(uint32_t *page_start_addr)
+{
+    return nrfx_nvmc_page_partial_erase_init((uint32_t)(uintptr_t)page_start_addr, NVMC_ERASE_SLICE_MS);
+}
+
+/**
+ * @brief Один шаг стирания длительностью NVMC_ERASE_SLICE_MS
+ * @return true если страница стерта полностью
+ */
+static bool nvmc_erase_page_step(void)
+{
+    uint32_t start = DWT->CYCCNT;
+    bool done = nrfx_nvmc_page_partial_erase_continue();
+
+    nvmc_measure(&nvmc_timing.max_erase_cycles, start);
+    nvmc_timing.erase_slices++;
+    return done;
+}
+
+/**
+ * @brief Адрес начала страницы области данных приложения
+ */
+static uint32_t *nvmc_page_address(uint32_t page)
+{
+    return (uint32_t *)(uintptr_t)(NVMC_PAGE_START + page * NVMC_PAGE_SIZE);
+}
+
+/**
+ * @brief Номер страницы, в которой находится адрес
+ */
+static uint8_t nvmc_page_of(const uint32_t *addr)
+{
+    return ((uintptr_t)addr - NVMC_PAGE_START) / NVMC_PAGE_SIZE;
+}
+
+/**
+ * @brief Число слов, занимаемых записью в журнале
+ */
+static uint32_t nvmc_entry_words(bool packed, uint32_t data_words)
+{
+    return packed ? 1 : data_words + NVMC_RECORD_OVERHEAD_WORDS;
+}
+
+/**
+ * @brief Ячейка индекса для ключа обычной или упакованной записи
+ */
+static uint32_t **nvmc_index_slot(bool packed, uint8_t key)
+{
+    return packed ? &nvmc_packed_index[key] : &nvmc_index[key];
+}
+
+/**
+ * @brief Бит ключа в маске каталога
+ */
+static uint32_t nvmc_key_bit(bool packed, uint8_t key)
+{
+    return 1UL << (packed ? NVMC_MAX_KEYS + key : key);
+}
+
+/**
+ * @brief Номер сегмента страницы, в котором находится адрес
+ */
+static uint8_t nvmc_segment_of(const uint32_t *addr)
+{
+    return ((uintptr_t)addr - NVMC_PAGE_START) % NVMC_PAGE_SIZE / (NVMC_SEGMENT_WORDS * NVMC_WORD_SIZE);
+}
+
+/**
+ * @brief Упаковка значения с ключом и проверочными битами в одно слово
+ */
+static uint32_t nvmc_packed_encode(nvmc_packed_key key, uint32_t value)
+{
+    uint32_t info = ((uint32_t)key << NVMC_PACKED_KEY_POS) | value;
+    uint32_t zeros = NVMC_PACKED_INFO_BITS - __builtin_popcount(info);
+
+    return info | (zeros << NVMC_PACKED_CHECK_POS);
+}
+
+/**
+ * @brief Проверка упакованного слова без ветвлений по полям
+ */
+static bool nvmc_packed_is_intact(uint32_t word)
+{
+    uint32_t zeros = NVMC_PACKED_INFO_BITS - __builtin_popcount(word & NVMC_PACKED_INFO_MASK);
+    return ((word >> NVMC_PACKED_CHECK_POS) & NVMC_PACKED_CHECK_MASK) == zeros;
+}
+
+/**
+ * @brief Проверка, что запись дописана: подтверждение записывается последним
  */
-static nrfx_err_t nvmc_erase_page(uint32_t *page_start_addr)
+static bool nvmc_record_is_committed(uint32_t *record, uint32_t data_words)
 {
-    return nrfx_nvmc_page_erase((uint32_t)page_start_addr);
+    uint32_t commit;
+
+    nvmc_read_word(record + data_words + 3, &commit);
+    return commit == NVMC_RECORD_COMMIT;
 }
 
 /**
- * @brief Поиск адреса последнего записанного блока
- * @param result Указатель для сохранения найденного адреса
- * @return true если нашли  блок, false если страница заполнена
+ * @brief Проверка CRC дописанной записи
  */
-static bool nvmc_find_last_address(uint32_t *result) //без bool
+static bool nvmc_record_is_intact(uint32_t *record)
 {
-    uint32_t *addr = (uint32_t *)NVMC_PAGE_START;
-    uint32_t *last_valid_addr = NULL;
-    uint32_t *page_end = (uint32_t *)(NVMC_PAGE_START + NVMC_PAGE_SIZE);
+    uint32_t header;
+    uint32_t crc;
+
+    nvmc_read_word(record, &header);
+    uint32_t data_words = NVMC_RECORD_DATA_WORDS(header);
+
+    nvmc_read_word(record + data_words + 2, &crc);
+    return crc == crc32_compute((const uint8_t *)record, (data_words + 2) * NVMC_WORD_SIZE, NULL);
+}
 
-    while (addr < page_end)
+/**
+ * @brief Число записанных слов каталога страницы, двоичный поиск
+ *
+ * Слова каталога пишутся по порядку, поэтому за первым стертым словом
+ * записанных нет. Сегменты с записанным словом закрыты, следующий за ними
+ * сегмент содержит конец журнала страницы.
+ */
+static uint32_t nvmc_directory_length(uint32_t page)
+{
+    uint32_t *directory = nvmc_page_address(page) + NVMC_PAGE_HEADER_WORDS;
+    uint32_t low = 0;
+    uint32_t high = NVMC_SEGMENT_COUNT;
+
+    while (low < high)
     {
-        uint32_t block_size;
-        nvmc_read_word(addr, &block_size);
+        uint32_t middle = (low + high) / 2;
+        uint32_t word;
 
-        if (block_size == NVMC_EMPTY_VALUE)
+        nvmc_read_word(directory + middle, &word);
+        if (word == NVMC_EMPTY_VALUE)
         {
-            *result = (uint32_t)last_valid_addr;    
-            return true;
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
         }
+    }
+
+    return low;
+}
 
-        last_valid_addr = addr;
-        addr += 1 + block_size / NVMC_WORD_SIZE;
+/**
+ * @brief Обход записей, начатых в сегменте страницы
+ *
+ * Обход читает только заголовок и подтверждение записи, CRC здесь не
+ * считается. Первая запись сегмента берется из каталога предыдущего сегмента.
+ *
+ * @param records Найденные записи ключей
+ * @return Адрес за последней записью: первое свободное слово, если сегмент
+ *         не закрыт; начало следующего сегмента после поврежденного заголовка
+ */
+static uint32_t *nvmc_walk_segment(uint32_t page, uint32_t segment, nvmc_segment_records *records)
+{
+    uint32_t *page_start = nvmc_page_address(page);
+    uint32_t *page_end = nvmc_page_address(page + 1);
+    uint32_t *segment_end = page_start + (segment + 1) * NVMC_SEGMENT_WORDS;
+    uint32_t *addr = page_start + NVMC_DATA_START_WORDS;
+
+    memset(records, 0, sizeof(*records));
+
+    if (segment > 0)
+    {
+        uint32_t word;
+        nvmc_read_word(page_start + NVMC_PAGE_HEADER_WORDS + segment - 1, &word);
+        addr = page_start + segment * NVMC_SEGMENT_WORDS + NVMC_DIRECTORY_OFFSET(word);
     }
 
-    nvmc_context.erase_needed = true;
-    return false;
+    while (addr < segment_end)
+    {
+        uint32_t header;
+        nvmc_read_word(addr, &header);
+
+        if (header == NVMC_EMPTY_VALUE)
+        {
+            return addr;
+        }
+
+        // Недописанное упакованное слово занимает одно слово и пропускается
+        if (!(header & NVMC_RECORD_FLAG))
+        {
+            if (nvmc_packed_is_intact(header))
+            {
+                records->latest[NVMC_MAX_KEYS + NVMC_PACKED_KEY(header)] = addr;
+                records->keys |= nvmc_key_bit(true, NVMC_PACKED_KEY(header));
+            }
+            addr++;
+            continue;
+        }
+
+        uint32_t data_words = NVMC_RECORD_DATA_WORDS(header);
+        uint32_t key = NVMC_RECORD_KEY(header);
+
+        // Поврежденный заголовок: длина неизвестна, остаток сегмента не используется
+        if (key >= NVMC_MAX_KEYS || data_words > NVMC_MAX_RECORD_SIZE / NVMC_WORD_SIZE ||
+            addr + data_words + NVMC_RECORD_OVERHEAD_WORDS > page_end)
+        {
+            return segment_end;
+        }
+
+        if (nvmc_record_is_committed(addr, data_words))
+        {
+            records->previous[key] = records->latest[key];
+            records->latest[key] = addr;
+            records->keys |= nvmc_key_bit(false, key);
+        }
+
+        addr += data_words + NVMC_RECORD_OVERHEAD_WORDS;
+    }
+
+    return addr;
+}
+
+/**
+ * @brief Выбор записей ключей по записям, найденным в сегменте
+ *
+ * Сегменты обходятся от новых к старым, поэтому первая найденная запись
+ * ключа - последняя. CRC считается только для нее и, если она повреждена,
+ * для предыдущей дописанной записи ключа. Дописанная запись с неверной
+ * CRC - это повреждение уже записанных данных, а не сбой записи, поэтому
+ * более старые записи не ищутся.
+ *
+ * @param wanted   Ключи, запись которых еще не выбрана
+ * @param fallback Ключи, последняя запись которых повреждена
+ */
+static void nvmc_recover_keys(const nvmc_segment_records *records, uint32_t *wanted, uint32_t *fallback)
+{
+    for (uint8_t slot = 0; slot < NVMC_KEY_SLOTS; ++slot)
+    {
+        uint32_t bit = 1UL << slot;
+        uint32_t *record = records->latest[slot];
+        uint32_t sequence;
+
+        if (!(*wanted & bit) || record == NULL)
+        {
+            continue;
+        }
+
+        if (slot >= NVMC_MAX_KEYS)
+        {
+            nvmc_packed_index[slot - NVMC_MAX_KEYS] = record;
+            *wanted &= ~bit;
+            continue;
+        }
+
+        if (!(*fallback & bit))
+        {
+            // Последняя запись ключа новее всех его записей, номер берется по ней
+            nvmc_read_word(record + 1, &sequence);
+            if ((int32_t)(sequence - nvmc_next_sequence) >= 0)
+            {
+                nvmc_next_sequence = sequence + 1;
+            }
+
+            if (nvmc_record_is_intact(record))
+            {
+                nvmc_index[slot] = record;
+                *wanted &= ~bit;
+                continue;
+            }
+
+            NRF_LOG_WARNING("NVMC: key %d record damaged, falling back", slot);
+            *fallback |= bit;
+
+            // Предыдущая запись ключа - в этом же сегменте или в более старом
+            record = records->previous[slot];
+            if (record == NULL)
+            {
+                continue;
+            }
+        }
+
+        nvmc_index[slot] = nvmc_record_is_intact(record) ? record : NULL;
+        *wanted &= ~bit;
+    }
 }
 
-void nvmc_initialize(uint32_t writable_block_size)
+void nvmc_initialize(void)
 {
-    nvmc_context.writable_block_size = writable_block_size;
-    nvmc_context.current_address = (uint32_t *)NVMC_PAGE_START;
+    uint8_t order[NVMC_PAGE_COUNT];
+    uint8_t log_pages = 0;
+    uint32_t wanted = NVMC_ALL_KEYS;
+    uint32_t fallback = 0;
+    nvmc_segment_records records;
+
+    memset(nvmc_index, 0, sizeof(nvmc_index));
+    memset(nvmc_packed_index, 0, sizeof(nvmc_packed_index));
+
+    for (uint8_t page = 0; page < NVMC_PAGE_COUNT; ++page)
+    {
+        uint32_t *page_start = nvmc_page_address(page);
+        uint32_t magic;
+
+        nvmc_read_word(page_start, &magic);
+        nvmc_read_word(page_start + 1, &nvmc_page_sequences[page]);
+
+        if (magic == NVMC_PAGE_MAGIC)
+        {
+            nvmc_page_states[page] = NVMC_PAGE_LOG;
+
+            // Вставка в порядке возрастания номера страницы
+            uint8_t position = log_pages++;
+            while (position > 0 &&
+                   (int32_t)(nvmc_page_sequences[order[position - 1]] - nvmc_page_sequences[page]) > 0)
+            {
+                order[position] = order[position - 1];
+                position--;
+            }
+            order[position] = page;
+        }
+        else
+        {
+            nvmc_page_states[page] = magic == NVMC_EMPTY_VALUE ? NVMC_PAGE_BLANK : NVMC_PAGE_DIRTY;
+        }
+    }
+
+    // Страницы и сегменты обходятся от новых к старым. Незакрытый сегмент
+    // обходится всегда, закрытый - только если по каталогу в нем есть ключ
+    // без выбранной записи, поэтому загрузка читает каталоги и не больше
+    // одного сегмента на ключ независимо от длины журнала
+    for (uint8_t i = log_pages; i-- > 0 && wanted != 0;)
+    {
+        uint8_t page = order[i];
+        uint32_t *directory = nvmc_page_address(page) + NVMC_PAGE_HEADER_WORDS;
+        uint32_t closed = nvmc_directory_length(page);
+        uint32_t *free_address = nvmc_page_address(page + 1);
+
+        records.keys = 0;
+        if (closed < NVMC_SEGMENT_COUNT)
+        {
+            free_address = nvmc_walk_segment(page, closed, &records);
+            nvmc_recover_keys(&records, &wanted, &fallback);
+        }
+
+        if (i == log_pages - 1)
+        {
+            nvmc_active_page = page;
+            nvmc_write_address = free_address;
+            nvmc_directory_next = closed;
+            nvmc_segment_keys = records.keys;
+            nvmc_next_page_sequence = nvmc_page_sequences[page] + 1;
+        }
+
+        for (uint32_t segment = closed; segment-- > 0 && wanted != 0;)
+        {
+            uint32_t word;
+
+            nvmc_read_word(directory + segment, &word);
+            if (word & wanted)
+            {
+                nvmc_walk_segment(page, segment, &records);
+                nvmc_recover_keys(&records, &wanted, &fallback);
+            }
+        }
+    }
+
+    NRF_LOG_INFO("NVMC: %d log pages, next record %d", log_pages, nvmc_next_sequence);
 }
 
-uint32_t nvmc_read_last_data(uint32_t *buffer)
+uint32_t nvmc_read(nvmc_key key, uint32_t *buffer, uint32_t size)
 {
-    uint32_t last_address = 0;
-//!nvmc_context.writable_block_size = writable_block_size; ??
-    if (!nvmc_find_last_address(&last_address))
+    uint32_t *record = key < NVMC_MAX_KEYS ? nvmc_index[key] : NULL;
+    uint32_t header;
+
+    if (record == NULL)
     {
         return 0;
     }
 
-    uint32_t block_size;
-    uint32_t *addr = (uint32_t *)last_address;
-    nvmc_read_word(addr, &block_size);
-
-    if (block_size != nvmc_context.writable_block_size)
+    nvmc_read_word(record, &header);
+    if (NVMC_RECORD_DATA_WORDS(header) * NVMC_WORD_SIZE != size)
     {
-        nvmc_context.erase_needed = true;
         return 0;
     }
 
-    nvmc_context.current_address = addr + 1;
-    for (uint32_t i = 0; i < nvmc_context.writable_block_size / NVMC_WORD_SIZE; ++i)
+    for (uint32_t i = 0; i < size / NVMC_WORD_SIZE; ++i)
     {
-        nvmc_read_word(nvmc_context.current_address++, &buffer[i]);
+        nvmc_read_word(record + 2 + i, &buffer[i]);
     }
 
-    return nvmc_context.writable_block_size;
+    return size;
 }
 
-void nvmc_write_data(uint32_t *data)
+bool nvmc_read_packed(nvmc_packed_key key, uint32_t *value)
 {
-    if (nvmc_context.erase_needed ||
-        ((uint32_t)nvmc_context.current_address + nvmc_context.writable_block_size + NVMC_WORD_SIZE >
-         NVMC_PAGE_START + NVMC_PAGE_SIZE))
+    uint32_t *record = key < NVMC_PACKED_MAX_KEYS ? nvmc_packed_index[key] : NULL;
+    uint32_t word;
+
+    if (record == NULL)
     {
-        nvmc_erase_page((uint32_t *)NVMC_PAGE_START);
+        return false;
+    }
+
+    nvmc_read_word(record, &word);
+    *value = word & NVMC_PACKED_VALUE_MAX;
+    return true;
+}
+
+/**
+ * @brief Добавление запроса в очередь записи
+ */
+static bool nvmc_enqueue(uint8_t key, const uint32_t *data, uint32_t words, bool packed,
+                         nvmc_write_callback callback, nvmc_packed_write_callback packed_callback)
+{
+    bool queued = false;
+
+    CRITICAL_REGION_ENTER();
+    if (nvmc_queue_count < NVMC_QUEUE_SIZE)
+    {
+        nvmc_request *request = &nvmc_queue[(nvmc_queue_head + nvmc_queue_count) % NVMC_QUEUE_SIZE];
+
+        request->key = key;
+        request->words = words;
+        request->packed = packed;
+        if (packed)
+        {
+            request->callback.packed = packed_callback;
+        }
+        else
+        {
+            request->callback.record = callback;
+        }
+        memcpy(request->data, data, packed ? NVMC_WORD_SIZE : words * NVMC_WORD_SIZE);
+        nvmc_queue_count++;
+        queued = true;
+    }
+    CRITICAL_REGION_EXIT();
+
+    return queued;
+}
+
+bool nvmc_write_async(nvmc_key key, const uint32_t *data, uint32_t size, nvmc_write_callback callback)
+{
+    if (key >= NVMC_MAX_KEYS || size > NVMC_MAX_RECORD_SIZE || size % NVMC_WORD_SIZE != 0)
+    {
+        return false;
+    }
+
+    return nvmc_enqueue(key, data, size / NVMC_WORD_SIZE, false, callback, NULL);
+}
+
+bool nvmc_write_packed_async(nvmc_packed_key key, uint32_t value, nvmc_packed_write_callback callback)
+{
+    if (key >= NVMC_PACKED_MAX_KEYS || value > NVMC_PACKED_VALUE_MAX)
+    {
+        return false;
+    }
+
+    uint32_t word = nvmc_packed_encode(key, value);
+    return nvmc_enqueue(key, &word, 0, true, NULL, callback);
+}
+
+/**
+ * @brief Поиск стертой страницы для продолжения журнала
+ */
+static uint8_t nvmc_find_blank_page(void)
+{
+    for (uint8_t i = 1; i <= NVMC_PAGE_COUNT; ++i)
+    {
+        uint8_t page = (nvmc_active_page == NVMC_NO_PAGE ? i - 1 : nvmc_active_page + i) % NVMC_PAGE_COUNT;
+
+        if (nvmc_page_states[page] == NVMC_PAGE_BLANK)
+        {
+            return page;
+        }
+    }
+    return NVMC_NO_PAGE;
+}
+
+/**
+ * @brief Выбор страницы для стирания, когда стертых страниц не осталось
+ *
+ * Сначала страницы без журнала, затем самая старая страница журнала.
+ */
+static uint8_t nvmc_find_gc_page(void)
+{
+    uint8_t oldest = NVMC_NO_PAGE;
 
-        nvmc_context.erase_needed = false;
-        nvmc_context.current_address = (uint32_t *)NVMC_PAGE_START;
+    for (uint8_t page = 0; page < NVMC_PAGE_COUNT; ++page)
+    {
+        if (nvmc_page_states[page] == NVMC_PAGE_DIRTY)
+        {
+            return page;
+        }
+        if (nvmc_page_states[page] == NVMC_PAGE_LOG && page != nvmc_active_page &&
+            (oldest == NVMC_NO_PAGE ||
+             (int32_t)(nvmc_page_sequences[page] - nvmc_page_sequences[oldest]) < 0))
+        {
+            oldest = page;
+        }
     }
+    return oldest;
+}
 
-    // Записываем размер блока
-    nvmc_write_word(nvmc_context.current_address++, nvmc_context.writable_block_size);
+/**
+ * @brief Первый шаг записи в сегменте nvmc_job.segment
+ *
+ * Слова каталога пройденных сегментов текущей страницы пишутся до первого
+ * слова записи, затем при необходимости открывается новая страница.
+ */
+static nvmc_state nvmc_record_state(void)
+{
+    if (nvmc_active_page != NVMC_NO_PAGE && nvmc_directory_next < nvmc_job.segment)
+    {
+        return NVMC_STATE_DIRECTORY;
+    }
 
-    // Записываем данные
-    for (uint32_t i = 0; i < nvmc_context.writable_block_size / NVMC_WORD_SIZE; ++i)
+    if (nvmc_job.segment == NVMC_SEGMENT_COUNT)
     {
-        nvmc_write_word(nvmc_context.current_address++, data[i]);
+        return NVMC_STATE_HEADER;
     }
+
+    nvmc_job.record = nvmc_write_address;
+    nvmc_job.sequence = nvmc_next_sequence++;
+    return NVMC_STATE_DATA;
 }
 
-bool nvmc_write_complete_check(void)
+/**
+ * @brief Начало записи: данные из очереди или перенос живой записи
+ *
+ * Если в текущей странице нет места, сначала открывается стертая страница.
+ * @return false если места нет и стертых страниц тоже нет
+ */
+static bool nvmc_begin_record(uint8_t key, uint16_t words, bool packed, const uint32_t *source, bool relocation)
 {
-    return nrfx_nvmc_write_done_check();
+    nvmc_job.key = key;
+    nvmc_job.words = words;
+    nvmc_job.packed = packed;
+    nvmc_job.source = source;
+    nvmc_job.relocation = relocation;
+    nvmc_job.index = 0;
+
+    if (nvmc_active_page == NVMC_NO_PAGE ||
+        nvmc_write_address + nvmc_entry_words(packed, words) > nvmc_page_address(nvmc_active_page + 1))
+    {
+        uint8_t page = nvmc_find_blank_page();
+
+        if (page == NVMC_NO_PAGE)
+        {
+            return false;
+        }
+
+        nvmc_job.page = page;
+        nvmc_job.segment = NVMC_SEGMENT_COUNT;
+    }
+    else
+    {
+        nvmc_job.segment = nvmc_segment_of(nvmc_write_address);
+    }
+
+    nvmc_job.state = nvmc_record_state();
+    return true;
+}
+
+/**
+ * @brief Слово записи с номером index: заголовок, номер, данные, CRC
+ *
+ * CRC считается по уже записанным во флеш словам, поэтому перенос живой
+ * записи не требует буфера в RAM.
+ */
+static uint32_t nvmc_record_word(uint32_t index)
+{
+    switch (index)
+    {
+    case 0:
+        return NVMC_RECORD_HEADER(nvmc_job.key, nvmc_job.words);
+    case 1:
+        return nvmc_job.sequence;
+    default:
+        break;
+    }
+
+    if (index - 2 < nvmc_job.words)
+    {
+        return nvmc_job.source[index - 2];
+    }
+
+    return crc32_compute((const uint8_t *)nvmc_job.record, (nvmc_job.words + 2) * NVMC_WORD_SIZE, NULL);
+}
+
+/**
+ * @brief Следующий шаг сборки мусора: перенос живой записи или стирание
+ * @return true если операция начата
+ */
+static bool nvmc_gc_step(void)
+{
+    for (uint8_t slot = 0; slot < NVMC_MAX_KEYS + NVMC_PACKED_MAX_KEYS; ++slot)
+    {
+        bool packed = slot >= NVMC_MAX_KEYS;
+        uint8_t key = packed ? slot - NVMC_MAX_KEYS : slot;
+        uint32_t *record = *nvmc_index_slot(packed, key);
+
+        if (record != NULL && nvmc_page_of(record) == nvmc_gc_page)
+        {
+            uint32_t header;
+            nvmc_read_word(record, &header);
+
+            if (!nvmc_begin_record(key, packed ? 0 : NVMC_RECORD_DATA_WORDS(header), packed,
+                                   packed ? record : record + 2, true))
+            {
+                NRF_LOG_ERROR("NVMC: no room to relocate key %d", key);
+                nvmc_gc_page = NVMC_NO_PAGE;
+                return false;
+            }
+            return true;
+        }
+    }
+
+    // Живых записей не осталось - страница стирается по частям
+    if (nvmc_erase_page_start(nvmc_page_address(nvmc_gc_page)) != NRFX_SUCCESS)
+    {
+        NRF_LOG_ERROR("NVMC: cannot start erase of page %d", nvmc_gc_page);
+        nvmc_gc_page = NVMC_NO_PAGE;
+        return false;
+    }
+    nvmc_job.page = nvmc_gc_page;
+    nvmc_job.state = NVMC_STATE_ERASE;
+    return true;
+}
+
+/**
+ * @brief Выбор следующей операции: сборка мусора или запись из очереди
+ *
+ * Сборка мусора идет первой: она освобождает страницу, без которой записи
+ * из очереди некуда будет продолжиться.
+ * @return true если операция начата
+ */
+static bool nvmc_start_next(void)
+{
+    if (nvmc_gc_page == NVMC_NO_PAGE && nvmc_find_blank_page() == NVMC_NO_PAGE)
+    {
+        nvmc_gc_page = nvmc_find_gc_page();
+    }
+
+    if (nvmc_gc_page != NVMC_NO_PAGE && nvmc_gc_step())
+    {
+        return true;
+    }
+
+    if (nvmc_queue_count > 0)
+    {
+        const nvmc_request *request = &nvmc_queue[nvmc_queue_head];
+        return nvmc_begin_record(request->key, request->words, request->packed, request->data, false);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Завершение записи: обновление индекса и очереди
+ */
+static void nvmc_finish_record(void)
+{
+    *nvmc_index_slot(nvmc_job.packed, nvmc_job.key) = nvmc_job.record;
+    nvmc_write_address = nvmc_job.record + nvmc_entry_words(nvmc_job.packed, nvmc_job.words);
+    nvmc_segment_keys |= nvmc_key_bit(nvmc_job.packed, nvmc_job.key);
+
+    if (nvmc_job.relocation)
+    {
+        return;
+    }
+
+    nvmc_request *request = &nvmc_queue[nvmc_queue_head];
+    if (request->packed && request->callback.packed)
+    {
+        request->callback.packed((nvmc_packed_key)request->key);
+    }
+    else if (!request->packed && request->callback.record)
+    {
+        request->callback.record((nvmc_key)request->key);
+    }
+
+    CRITICAL_REGION_ENTER();
+    nvmc_queue_head = (nvmc_queue_head + 1) % NVMC_QUEUE_SIZE;
+    nvmc_queue_count--;
+    CRITICAL_REGION_EXIT();
+}
+
+/**
+ * @brief Один шаг автомата записи
+ * @return true если работа не закончена
+ */
+static bool nvmc_step(void)
+{
+    // Предыдущее слово еще пишется - шаг не блокирует ожиданием
+    if (!nrfx_nvmc_write_done_check())
+    {
+        return true;
+    }
+
+    switch (nvmc_job.state)
+    {
+    case NVMC_STATE_IDLE:
+        return nvmc_start_next();
+
+    case NVMC_STATE_ERASE:
+        if (nvmc_erase_page_step())
+        {
+            nvmc_page_states[nvmc_job.page] = NVMC_PAGE_BLANK;
+            nvmc_gc_page = NVMC_NO_PAGE;
+            nvmc_job.state = NVMC_STATE_IDLE;
+        }
+        break;
+
+    case NVMC_STATE_HEADER:
+    {
+        uint32_t *page_start = nvmc_page_address(nvmc_job.page);
+
+        if (nvmc_job.index == 0)
+        {
+            nvmc_write_word(page_start, NVMC_PAGE_MAGIC);
+            nvmc_job.index++;
+        }
+        else
+        {
+            nvmc_write_word(page_start + 1, nvmc_next_page_sequence);
+            nvmc_page_sequences[nvmc_job.page] = nvmc_next_page_sequence++;
+            nvmc_page_states[nvmc_job.page] = NVMC_PAGE_LOG;
+            nvmc_active_page = nvmc_job.page;
+            nvmc_write_address = page_start + NVMC_DATA_START_WORDS;
+            nvmc_directory_next = 0;
+            nvmc_segment_keys = 0;
+
+            nvmc_job.index = 0;
+            nvmc_job.segment = 0;
+            nvmc_job.state = nvmc_record_state();
+        }
+        break;
+    }
+
+    case NVMC_STATE_DIRECTORY:
+    {
+        uint32_t *page_start = nvmc_page_address(nvmc_active_page);
+        uint32_t *next = page_start + (nvmc_directory_next + 1) * NVMC_SEGMENT_WORDS;
+        uint32_t offset = 0;
+
+        // Последняя запись сегмента может заходить в следующий
+        if (nvmc_write_address >= next && nvmc_write_address < next + NVMC_SEGMENT_WORDS)
+        {
+            offset = nvmc_write_address - next;
+        }
+
+        nvmc_write_word(page_start + NVMC_PAGE_HEADER_WORDS + nvmc_directory_next,
+                        NVMC_DIRECTORY_WORD(nvmc_segment_keys, offset));
+        nvmc_directory_next++;
+        nvmc_segment_keys = 0;
+        nvmc_job.state = nvmc_record_state();
+        break;
+    }
+
+    case NVMC_STATE_DATA:
+        if (nvmc_job.packed)
+        {
+            // Одно слово - и данные, и подтверждение
+            nvmc_write_word(nvmc_job.record, nvmc_job.source[0]);
+            nvmc_finish_record();
+            nvmc_job.state = NVMC_STATE_IDLE;
+            break;
+        }
+
+        nvmc_write_word(nvmc_job.record + nvmc_job.index, nvmc_record_word(nvmc_job.index));
+        if (++nvmc_job.index == nvmc_job.words + NVMC_RECORD_OVERHEAD_WORDS - 1)
+        {
+            nvmc_job.state = NVMC_STATE_COMMIT;
+        }
+        break;
+
+    case NVMC_STATE_COMMIT:
+        // Подтверждение последним: запись без него при загрузке пропускается
+        nvmc_write_word(nvmc_job.record + nvmc_job.index, NVMC_RECORD_COMMIT);
+        nvmc_finish_record();
+        nvmc_job.state = NVMC_STATE_IDLE;
+        break;
+
+    default:
+        nvmc_job.state = NVMC_STATE_IDLE;
+        break;
+    }
+
+    return true;
+}
+
+bool nvmc_process(void)
+{
+    uint32_t start = DWT->CYCCNT;
+    bool busy = nvmc_step();
+
+    nvmc_measure(&nvmc_timing.max_step_cycles, start);
+    return busy;
+}
+
+void nvmc_get_stats(nvmc_stats *stats, bool reset)
+{
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+
+    stats->max_step_us = nvmc_timing.max_step_cycles / cycles_per_us;
+    stats->max_write_us = nvmc_timing.max_write_cycles / cycles_per_us;
+    stats->max_erase_us = nvmc_timing.max_erase_cycles / cycles_per_us;
+    stats->erase_slices = nvmc_timing.erase_slices;
+    stats->words_written = nvmc_timing.words_written;
+
+    if (reset)
+    {
+        memset(&nvmc_timing, 0, sizeof(nvmc_timing));
+    }
 }
@@ -4,29 +4,134 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "nrf_dfu_types.h"
+
+/**
+ * @brief Хранилище ключ-значение в области данных приложения
+ *
+ * Журнал записей вращается по всем страницам области. Страница делится на
+ * сегменты, каталог в начале страницы хранит ключи записей каждого
+ * закрытого сегмента. При загрузке конец журнала страницы находится
+ * двоичным поиском по каталогу, а индекс в RAM строится обходом незакрытого
+ * сегмента и не больше одного сегмента на ключ, поэтому число чтений не
+ * зависит от заполнения журнала. CRC проверяется только у последней записи
+ * каждого ключа. После этого чтение - O(1).
+ * Запись только добавляется в конец журнала. Когда стертых страниц не
+ * остается, самая старая страница освобождается сборкой мусора: ее живые
+ * записи по слову переносятся в текущую, затем она стирается по частям.
+ */
+
+#define NVMC_PAGE_SIZE (0x1000)
+#define NVMC_PAGE_COUNT (NRF_DFU_APP_DATA_AREA_SIZE / NVMC_PAGE_SIZE)
+
+// Размер сегмента страницы в словах: больше - короче каталог, но длиннее
+// обход сегмента при загрузке
+#define NVMC_SEGMENT_WORDS 128
+
+// Ключи хранилища
+typedef enum
+{
+    NVMC_KEY_SETTINGS,
+    NVMC_KEY_PALETTE,
+    NVMC_KEY_PRESETS,   // первая группа пресетов, следующие группы занимают следующие ключи
+} nvmc_key;
+
+#define NVMC_MAX_KEYS 16
+
+// Наибольший размер значения, байт
+#define NVMC_MAX_RECORD_SIZE 96
+
+// Ключи упакованных значений: отдельное пространство, не пересекается с nvmc_key
+typedef enum
+{
+    NVMC_PACKED_KEY_COLOR,
+} nvmc_packed_key;
+
+// Упакованные значения: ключи 0..7, значение до 23 бит, одно слово во флеш
+#define NVMC_PACKED_MAX_KEYS 8
+#define NVMC_PACKED_VALUE_MAX 0x7FFFFFUL
+
+// Наибольшие длительности операций с флеш, за время которых процессор остановлен
+typedef struct
+{
+    uint32_t max_step_us;   // шаг nvmc_process() целиком, включая расчет CRC
+    uint32_t max_write_us;  // запись одного слова
+    uint32_t max_erase_us;  // одна часть стирания страницы
+    uint32_t erase_slices;
+    uint32_t words_written;
+} nvmc_stats;
+
+/** Вызывается из nvmc_process() после записи значения */
+typedef void (*nvmc_write_callback)(nvmc_key key);
+
+/** Вызывается из nvmc_process() после записи упакованного значения */
+typedef void (*nvmc_packed_write_callback)(nvmc_packed_key key);
+
+/**
+ * @brief Инициализация хранилища: поиск конца журнала и построение индекса
+ */
+void nvmc_initialize(void);
+
+/**
+ * @brief Чтение последнего сохраненного значения ключа
+ * @param key    Ключ
+ * @param buffer Буфер для чтения данных
+ * @param size   Ожидаемый размер значения в байтах
+ * @return Размер прочитанных данных в байтах, 0 если значения нет или размер другой
+ */
+uint32_t nvmc_read(nvmc_key key, uint32_t *buffer, uint32_t size);
+
+/**
+ * @brief Постановка значения в очередь записи
+ *
+ * Данные копируются, буфер можно менять сразу после вызова.
+ *
+ * @param key      Ключ
+ * @param data     Данные для записи
+ * @param size     Размер в байтах, кратный 4, не более NVMC_MAX_RECORD_SIZE
+ * @param callback Обработчик завершения записи, может быть NULL
+ * @return false если очередь заполнена или размер недопустим
+ */
+bool nvmc_write_async(nvmc_key key, const uint32_t *data, uint32_t size, nvmc_write_callback callback);
+
 /**
- * @brief Инициализация NVMC
- * @param writable_block_size Размер блока в байтах
+ * @brief Чтение упакованного значения ключа
+ * @param key   Ключ, меньше NVMC_PACKED_MAX_KEYS
+ * @param value Прочитанное значение
+ * @return false если значения нет
  */
-void nvmc_initialize(uint32_t writable_block_size);
+bool nvmc_read_packed(nvmc_packed_key key, uint32_t *value);
 
 /**
- * @brief Чтение последнего записанного блока
- * @param buffer  Буфер для чтения данных
- * @return Размер прочитанных данных в байтах, 0 если чтение не удалось
+ * @brief Постановка упакованного значения в очередь записи
+ *
+ * Значение вместе с ключом и проверочными битами занимает одно слово
+ * журнала вместо заголовка, номера, CRC и подтверждения обычной записи.
+ *
+ * @param key      Ключ, меньше NVMC_PACKED_MAX_KEYS
+ * @param value    Значение, не больше NVMC_PACKED_VALUE_MAX
+ * @param callback Обработчик завершения записи, может быть NULL
+ * @return false если очередь заполнена или ключ и значение недопустимы
  */
-uint32_t nvmc_read_last_data(uint32_t *buffer);
+bool nvmc_write_packed_async(nvmc_packed_key key, uint32_t value, nvmc_packed_write_callback callback);
 
 /**
- * @brief Запись блока данных
- * @param data  Данные для записи
+ * @brief Шаг автомата записи, вызывается из основного цикла
+ *
+ * За шаг записывается одно слово или выполняется одна часть стирания
+ * страницы (NVMC_ERASE_SLICE_MS), поэтому прерывания ШИМ, кнопок и USB
+ * задерживаются не дольше одного шага. Сборка мусора выполняется теми же
+ * шагами перед записями из очереди.
+ *
+ * @return true если работа не закончена и основной цикл не должен засыпать
  */
-void nvmc_write_data(uint32_t *data);
+bool nvmc_process(void);
 
 /**
- * @brief Проверка завершения записи
- * @return true - запись завершена, false - запись продолжается
+ * @brief Измеренные длительности операций (такты DWT, мкс)
+ * @param stats Счетчики
+ * @param reset Обнулить счетчики после чтения
  */
-bool nvmc_write_complete_check(void);
+void nvmc_get_stats(nvmc_stats *stats, bool reset);
 
 #endif /* NVMC_CONTROL_H */
@@ -0,0 +1,141 @@
+/**
+ * @brief Модуль градиентных палитр
+ *
+ * Градиент из 2-16 опорных точек при загрузке запекается в таблицу на 256
+ * цветов, поэтому выборка цвета эффектом - одно индексное чтение.
+ */
+
+#include "palette_control.h"
+#include "nvmc_control.h"
+
+#include "nrf_log.h"
+
+
+static palette_t palette_current = {
+    .count = 2,
+    .stops = {
+        {.position = 0, .red = 255, .green = 0, .blue = 0},
+        {.position = 255, .red = 0, .green = 0, .blue = 255}}};
+
+static RGB_color palette_lut[PALETTE_LUT_SIZE];
+
+/**
+ * @brief Проверка палитры: число точек и возрастание позиций
+ */
+static bool palette_is_valid(const palette_t *palette)
+{
+    if (palette->count < PALETTE_MIN_STOPS || palette->count > PALETTE_MAX_STOPS)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 1; i < palette->count; ++i)
+    {
+        if (palette->stops[i].position <= palette->stops[i - 1].position)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Линейная интерполяция одного канала между двумя точками
+ */
+static uint8_t palette_lerp(uint8_t from, uint8_t to, uint32_t offset, uint32_t span)
+{
+    int32_t delta = (int32_t)to - (int32_t)from;
+    return (uint8_t)(from + delta * (int32_t)offset / (int32_t)span);
+}
+
+/**
+ * @brief Запекание текущей палитры в таблицу
+ *
+ * До первой точки и после последней цвет не меняется.
+ */
+static void palette_bake(void)
+{
+    const palette_stop *first = &palette_current.stops[0];
+    const palette_stop *last = &palette_current.stops[palette_current.count - 1];
+    uint32_t segment = 0;
+
+    for (uint32_t position = 0; position < PALETTE_LUT_SIZE; ++position)
+    {
+        const palette_stop *from;
+        const palette_stop *to;
+
+        if (position <= first->position)
+        {
+            from = to = first;
+        }
+        else if (position >= last->position)
+        {
+            from = to = last;
+        }
+        else
+        {
+            while (position > palette_current.stops[segment + 1].position)
+            {
+                segment++;
+            }
+            from = &palette_current.stops[segment];
+            to = &palette_current.stops[segment + 1];
+        }
+
+        if (from == to)
+        {
+            palette_lut[position].red = from->red;
+            palette_lut[position].green = from->green;
+            palette_lut[position].blue = from->blue;
+            continue;
+        }
+
+        uint32_t offset = position - from->position;
+        uint32_t span = to->position - from->position;
+        palette_lut[position].red = palette_lerp(from->red, to->red, offset, span);
+        palette_lut[position].green = palette_lerp(from->green, to->green, offset, span);
+        palette_lut[position].blue = palette_lerp(from->blue, to->blue, offset, span);
+    }
+}
+
+void palette_init(void)
+{
+    palette_t saved;
+
+    if (nvmc_read(NVMC_KEY_PALETTE, (uint32_t *)&saved, sizeof(palette_t)) > 0 && palette_is_valid(&saved))
+    {
+        palette_current = saved;
+        NRF_LOG_INFO("Palette restored: %d stops", saved.count);
+    }
+
+    palette_bake();
+}
+
+bool palette_load(const palette_t *palette)
+{
+    if (!palette_is_valid(palette))
+    {
+        NRF_LOG_WARNING("Invalid palette");
+        return false;
+    }
+
+    palette_current = *palette;
+    palette_bake();
+    return true;
+}
+
+static void palette_save_done(nvmc_key key)
+{
+    NRF_LOG_INFO("Palette saved");
+}
+
+bool palette_save(void)
+{
+    return nvmc_write_async(NVMC_KEY_PALETTE, (uint32_t *)&palette_current, sizeof(palette_t), palette_save_done);
+}
+
+RGB_color palette_sample(uint8_t position)
+{
+    return palette_lut[position];
+}
@@ -0,0 +1,52 @@
+#ifndef PALETTE_CONTROL_H
+#define PALETTE_CONTROL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "led_control.h"
+
+#define PALETTE_MIN_STOPS 2
+#define PALETTE_MAX_STOPS 16
+#define PALETTE_LUT_SIZE 256
+
+typedef struct
+{
+    uint8_t position;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+} palette_stop;
+
+typedef struct
+{
+    uint32_t count;
+    palette_stop stops[PALETTE_MAX_STOPS];
+} palette_t;
+
+/**
+ * @brief Инициализация палитры: загрузка сохраненной или палитры по умолчанию
+ */
+void palette_init(void);
+
+/**
+ * @brief Загрузка палитры и запекание ее в таблицу
+ * @param palette Палитра, точки должны идти по возрастанию позиции
+ * @return true если палитра корректна и загружена
+ */
+bool palette_load(const palette_t *palette);
+
+/**
+ * @brief Постановка текущей палитры в очередь записи во флеш
+ * @return false если очередь записи заполнена
+ */
+bool palette_save(void);
+
+/**
+ * @brief Получение цвета палитры по позиции
+ * @param position позиция в палитре (0-255)
+ * @return Цвет из таблицы
+ */
+RGB_color palette_sample(uint8_t position);
+
+#endif // PALETTE_CONTROL_H
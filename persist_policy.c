@@ -0,0 +1,144 @@
+/**
+ * @brief Модуль отложенного и объединенного сохранения настроек
+ *
+ * Отметка изменения только запоминает время, таймер не перезапускается на
+ * каждое изменение. Основной цикл запускает один таймер до ближайшего срока
+ * и при срабатывании проверяет, не было ли изменений с тех пор.
+ */
+
+#include "persist_policy.h"
+
+#include "app_timer.h"
+#include "app_util_platform.h"
+
+#include "nrf_log.h"
+
+APP_TIMER_DEF(timer_persist);
+
+static persist_flush_handler flush_handler = NULL;
+
+static uint32_t quiet_ticks = APP_TIMER_TICKS(PERSIST_QUIET_MS_DEFAULT);
+static uint32_t max_delay_ticks = APP_TIMER_TICKS(PERSIST_MAX_DELAY_MS_DEFAULT);
+
+static volatile bool dirty = false;
+static volatile uint32_t first_change = 0;
+static volatile uint32_t last_change = 0;
+static volatile bool timer_running = false;
+
+static persist_stats_t stats;
+
+/**
+ * @brief Таймер только будит основной цикл, проверка в persist_process()
+ */
+static void persist_timer_handler(void *p_context)
+{
+    timer_running = false;
+}
+
+void persist_init(persist_flush_handler handler)
+{
+    flush_handler = handler;
+    app_timer_create(&timer_persist, APP_TIMER_MODE_SINGLE_SHOT, persist_timer_handler);
+}
+
+void persist_mark_dirty(void)
+{
+    uint32_t now = app_timer_cnt_get();
+
+    CRITICAL_REGION_ENTER();
+    if (!dirty)
+    {
+        first_change = now;
+        dirty = true;
+    }
+    last_change = now;
+    stats.marks++;
+    CRITICAL_REGION_EXIT();
+}
+
+void persist_process(void)
+{
+    if (!dirty || flush_handler == NULL)
+    {
+        return;
+    }
+
+    uint32_t now = app_timer_cnt_get();
+    uint32_t quiet;
+    uint32_t pending;
+
+    CRITICAL_REGION_ENTER();
+    quiet = app_timer_cnt_diff_compute(now, last_change);
+    pending = app_timer_cnt_diff_compute(now, first_change);
+    CRITICAL_REGION_EXIT();
+
+    if (quiet < quiet_ticks && pending < max_delay_ticks)
+    {
+        if (!timer_running)
+        {
+            uint32_t quiet_left = quiet_ticks - quiet;
+            uint32_t pending_left = max_delay_ticks - pending;
+            uint32_t timeout = quiet_left < pending_left ? quiet_left : pending_left;
+
+            timer_running = true;
+            app_timer_start(timer_persist, timeout < APP_TIMER_MIN_TIMEOUT_TICKS ? APP_TIMER_MIN_TIMEOUT_TICKS : timeout,
+                            NULL);
+        }
+        return;
+    }
+
+    // Изменения после этой точки снова отметят настройки
+    dirty = false;
+
+    switch (flush_handler())
+    {
+    case PERSIST_WRITTEN:
+        stats.writes++;
+        if (quiet < quiet_ticks)
+        {
+            stats.forced++;
+        }
+        break;
+
+    case PERSIST_UNCHANGED:
+        stats.unchanged++;
+        break;
+
+    case PERSIST_RETRY:
+    default:
+        // Повтор через период тишины, время первого изменения сохраняется
+        CRITICAL_REGION_ENTER();
+        if (!dirty)
+        {
+            dirty = true;
+            last_change = now;
+        }
+        CRITICAL_REGION_EXIT();
+        break;
+    }
+}
+
+bool persist_set_timing(uint32_t quiet_ms, uint32_t max_delay_ms)
+{
+    if (max_delay_ms < quiet_ms || max_delay_ms > PERSIST_MAX_DELAY_MS_LIMIT)
+    {
+        return false;
+    }
+
+    quiet_ticks = APP_TIMER_TICKS(quiet_ms);
+    max_delay_ticks = APP_TIMER_TICKS(max_delay_ms);
+
+    NRF_LOG_INFO("Persist: quiet %d ms, max delay %d ms", quiet_ms, max_delay_ms);
+    return true;
+}
+
+void persist_get_stats(persist_stats_t *result, bool reset)
+{
+    CRITICAL_REGION_ENTER();
+    *result = stats;
+    if (reset)
+    {
+        stats = (persist_stats_t){0};
+    }
+    CRITICAL_REGION_EXIT();
+}
@@ -0,0 +1,74 @@
+#ifndef PERSIST_POLICY_H
+#define PERSIST_POLICY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Политика отложенного сохранения настроек во флеш
+ *
+ * Любой источник изменения (кнопки, CLI) только отмечает настройки
+ * измененными. Запись выполняется из основного цикла, когда изменений не
+ * было в течение периода тишины, но не позже предельной задержки от первого
+ * несохраненного изменения. Серия изменений дает одну запись во флеш.
+ */
+
+#define PERSIST_QUIET_MS_DEFAULT 2000
+#define PERSIST_MAX_DELAY_MS_DEFAULT 30000
+
+// Ограничение 24-битного счетчика RTC при частоте 16384 Гц
+#define PERSIST_MAX_DELAY_MS_LIMIT 600000
+
+typedef enum
+{
+    PERSIST_WRITTEN,    // запись поставлена в очередь
+    PERSIST_UNCHANGED,  // значение совпадает с сохраненным
+    PERSIST_RETRY       // очередь записи заполнена, повторить позже
+} persist_result;
+
+/** Запись настроек, вызывается из persist_process() */
+typedef persist_result (*persist_flush_handler)(void);
+
+typedef struct
+{
+    uint32_t marks;     // отметок изменения
+    uint32_t writes;    // записей во флеш
+    uint32_t unchanged; // сбросов без записи: значение вернулось к сохраненному
+    uint32_t forced;    // записей по предельной задержке, а не по тишине
+} persist_stats_t;
+
+/**
+ * @brief Инициализация политики (app_timer должен быть инициализирован)
+ * @param handler функция записи настроек
+ */
+void persist_init(persist_flush_handler handler);
+
+/**
+ * @brief Отметка изменения настроек
+ */
+void persist_mark_dirty(void);
+
+/**
+ * @brief Запись настроек, если истек период тишины или предельная задержка
+ *
+ * Вызывается из основного цикла. Пока настройки не сохранены, запущен
+ * таймер до ближайшего срока, чтобы процессор проснулся к нему.
+ */
+void persist_process(void);
+
+/**
+ * @brief Настройка периода тишины и предельной задержки записи
+ * @param quiet_ms     время без изменений до записи в мс
+ * @param max_delay_ms наибольшее время от первого изменения до записи в мс
+ * @return false если max_delay_ms меньше quiet_ms или больше предела
+ */
+bool persist_set_timing(uint32_t quiet_ms, uint32_t max_delay_ms);
+
+/**
+ * @brief Счетчики политики; отметок без записи = marks - writes
+ * @param stats счетчики
+ * @param reset обнулить счетчики после чтения
+ */
+void persist_get_stats(persist_stats_t *stats, bool reset);
+
+#endif // PERSIST_POLICY_H
@@ -0,0 +1,148 @@
+/**
+ * @brief Модуль банка пресетов цвета
+ *
+ * Пресеты хранятся группами по PRESET_GROUP_SIZE: группа - одно значение
+ * хранилища nvmc_control, цвет в ней упакован в одно слово. Сохранение
+ * пресета перезаписывает только его группу. Копия всех групп лежит в RAM,
+ * поэтому вызов пресета не обращается к флеш.
+ */
+
+#include "preset_bank.h"
+#include "nvmc_control.h"
+
+#include <string.h>
+
+#include "app_util.h"
+#include "nrf_log.h"
+
+#define PRESET_GROUP_SIZE 4
+#define PRESET_GROUP_COUNT (PRESET_COUNT / PRESET_GROUP_SIZE)
+
+// Упакованные цвета не больше 23 бит, поэтому пустой пресет не спутать с цветом
+#define PRESET_EMPTY 0xFFFFFFFF
+
+typedef struct
+{
+    uint32_t colors[PRESET_GROUP_SIZE];
+    char names[PRESET_GROUP_SIZE][PRESET_NAME_SIZE];
+} preset_group;
+
+STATIC_ASSERT(PRESET_COUNT % PRESET_GROUP_SIZE == 0);
+STATIC_ASSERT(sizeof(preset_group) <= NVMC_MAX_RECORD_SIZE);
+STATIC_ASSERT(NVMC_KEY_PRESETS + PRESET_GROUP_COUNT <= NVMC_MAX_KEYS);
+
+static preset_group preset_groups[PRESET_GROUP_COUNT];
+
+// Последний вызванный пресет, от него считается следующий
+static uint32_t preset_current = PRESET_COUNT - 1;
+
+void preset_init(void)
+{
+    uint8_t loaded = 0;
+
+    for (uint32_t group = 0; group < PRESET_GROUP_COUNT; ++group)
+    {
+        if (nvmc_read(NVMC_KEY_PRESETS + group, (uint32_t *)&preset_groups[group], sizeof(preset_group)) > 0)
+        {
+            loaded++;
+        }
+        else
+        {
+            memset(&preset_groups[group], 0, sizeof(preset_group));
+            memset(preset_groups[group].colors, 0xFF, sizeof(preset_groups[group].colors));
+        }
+    }
+
+    NRF_LOG_INFO("Presets: %d of %d groups restored", loaded, PRESET_GROUP_COUNT);
+}
+
+bool preset_get(uint32_t index, HSB_color *color, const char **name)
+{
+    if (index >= PRESET_COUNT)
+    {
+        return false;
+    }
+
+    preset_group *group = &preset_groups[index / PRESET_GROUP_SIZE];
+    uint32_t packed = group->colors[index % PRESET_GROUP_SIZE];
+
+    if (packed == PRESET_EMPTY || !led_hsb_unpack(packed, color))
+    {
+        return false;
+    }
+
+    if (name)
+    {
+        *name = group->names[index % PRESET_GROUP_SIZE];
+    }
+    return true;
+}
+
+bool preset_recall(uint32_t index)
+{
+    HSB_color color;
+
+    if (!preset_get(index, &color, NULL))
+    {
+        return false;
+    }
+
+    led_set_hsv_color(color.hue, color.saturation, color.brightness);
+    preset_current = index;
+    return true;
+}
+
+void preset_next(void)
+{
+    for (uint32_t i = 1; i <= PRESET_COUNT; ++i)
+    {
+        uint32_t index = (preset_current + i) % PRESET_COUNT;
+
+        if (preset_recall(index))
+        {
+            NRF_LOG_INFO("Preset %d", index);
+            return;
+        }
+    }
+}
+
+static void preset_save_done(nvmc_key key)
+{
+    NRF_LOG_INFO("Preset group %d saved", key - NVMC_KEY_PRESETS);
+}
+
+bool preset_save(uint32_t index, const char *name)
+{
+    if (index >= PRESET_COUNT)
+    {
+        return false;
+    }
+
+    uint32_t group_index = index / PRESET_GROUP_SIZE;
+    preset_group *group = &preset_groups[group_index];
+    preset_group previous = *group;
+    HSB_color color = led_get_hsv_color();
+
+    group->colors[index % PRESET_GROUP_SIZE] = led_hsb_pack(&color);
+    memset(group->names[index % PRESET_GROUP_SIZE], 0, PRESET_NAME_SIZE);
+    if (name)
+    {
+        strncpy(group->names[index % PRESET_GROUP_SIZE], name, PRESET_NAME_SIZE - 1);
+    }
+
+    // Неизмененный пресет не перезаписывается
+    if (memcmp(&previous, group, sizeof(preset_group)) == 0)
+    {
+        return true;
+    }
+
+    if (!nvmc_write_async(NVMC_KEY_PRESETS + group_index, (uint32_t *)group, sizeof(preset_group),
+                          preset_save_done))
+    {
+        *group = previous;
+        return false;
+    }
+
+    preset_current = index;
+    return true;
+}
@@ -0,0 +1,51 @@
+#ifndef PRESET_BANK_H
+#define PRESET_BANK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "led_control.h"
+
+#define PRESET_COUNT 16
+
+// Имя пресета вместе с завершающим нулем
+#define PRESET_NAME_SIZE 8
+
+/**
+ * @brief Инициализация банка: загрузка пресетов из флеш в RAM
+ *
+ * Вызывается после nvmc_initialize(). Дальше флеш при вызове пресета
+ * не читается.
+ */
+void preset_init(void);
+
+/**
+ * @brief Вызов пресета: установка его цвета
+ * @param index номер пресета (0 - PRESET_COUNT-1)
+ * @return false если номер неверный или пресет пуст
+ */
+bool preset_recall(uint32_t index);
+
+/**
+ * @brief Вызов следующего непустого пресета по кругу
+ */
+void preset_next(void);
+
+/**
+ * @brief Сохранение текущего цвета в пресет
+ * @param index номер пресета (0 - PRESET_COUNT-1)
+ * @param name  имя, обрезается до PRESET_NAME_SIZE-1 символов, может быть NULL
+ * @return false если номер неверный или очередь записи заполнена
+ */
+bool preset_save(uint32_t index, const char *name);
+
+/**
+ * @brief Чтение пресета из RAM
+ * @param index номер пресета (0 - PRESET_COUNT-1)
+ * @param color цвет пресета
+ * @param name  имя пресета, может быть NULL
+ * @return false если номер неверный или пресет пуст
+ */
+bool preset_get(uint32_t index, HSB_color *color, const char **name);
+
+#endif // PRESET_BANK_H
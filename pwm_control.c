@@ -1,5 +1,6 @@
 #include "pwm_control.h"
 #include "led_control.h"
+#include "latency_trace.h"
 
 #include "nrf_gpio.h"
 #include "nrfx_pwm.h"
@@ -13,14 +14,13 @@
 #include "app_usbd.h"
 #include "app_usbd_serial_num.h"
 
-#define APP_TIMER_REPEATED_MS 30
-
 APP_TIMER_DEF(timer_pwm);
 
 static nrfx_pwm_t rgb_instance = NRFX_PWM_INSTANCE(0);
 static nrfx_pwm_t led_instance = NRFX_PWM_INSTANCE(1);
 
 static void pwm_timer_handler(void *p_context);
+static void pwm_event_handler(nrfx_pwm_evt_type_t event_type);
 
 static nrf_pwm_values_individual_t pwm_duty_cycles;
 static nrf_pwm_sequence_t const pwm_sequence =
@@ -48,7 +48,7 @@ void pwm_controller_init(void)
     led_config.load_mode = NRF_PWM_LOAD_INDIVIDUAL;
     led_config.top_value = PWM_TOP_VALUE;
 
-    nrfx_pwm_init(&rgb_instance, &pwm_config, NULL);
+    nrfx_pwm_init(&rgb_instance, &pwm_config, pwm_event_handler);
     nrfx_pwm_init(&led_instance, &led_config, NULL);
 
     app_timer_init();
@@ -59,16 +59,34 @@ static void pwm_timer_handler(void *p_context)
 {
     led_display_current_color();
     update_value_LED1();
+
+    if (latency_trace_waiting(LATENCY_STAGE_PWM_RELOAD))
+    {
+        // Прерывание конца последовательности включается только на время
+        // измерения: следующая последовательность загрузит новые значения
+        nrf_pwm_event_clear(rgb_instance.p_registers, NRF_PWM_EVENT_SEQEND0);
+        nrf_pwm_int_enable(rgb_instance.p_registers, NRF_PWM_INT_SEQEND0_MASK);
+    }
+}
+
+static void pwm_event_handler(nrfx_pwm_evt_type_t event_type)
+{
+    if (event_type == NRFX_PWM_EVT_END_SEQ0)
+    {
+        nrf_pwm_int_disable(rgb_instance.p_registers, NRF_PWM_INT_SEQEND0_MASK);
+        latency_trace_mark(LATENCY_STAGE_PWM_RELOAD);
+    }
 }
 
 void pwm_timer_start(void)
 {
-    app_timer_start(timer_pwm, APP_TIMER_TICKS(APP_TIMER_REPEATED_MS), NULL);
+    app_timer_start(timer_pwm, APP_TIMER_TICKS(PWM_FRAME_INTERVAL_MS), NULL);
 }
 
 void pwm_start_playback(void)
 {
-    nrfx_pwm_simple_playback(&rgb_instance, &pwm_sequence, 1, NRFX_PWM_FLAG_LOOP);
+    nrfx_pwm_simple_playback(&rgb_instance, &pwm_sequence, 1, NRFX_PWM_FLAG_LOOP | NRFX_PWM_FLAG_SIGNAL_END_SEQ0);
+    nrf_pwm_int_disable(rgb_instance.p_registers, NRF_PWM_INT_SEQEND0_MASK);
     nrfx_pwm_simple_playback(&led_instance, &pwm_sequence, 1, NRFX_PWM_FLAG_LOOP);
 }
 
@@ -5,6 +5,7 @@
 #include <stdbool.h>
 
 #define PWM_TOP_VALUE 255
+#define PWM_FRAME_INTERVAL_MS 30
 
 void pwm_controller_init(void);
 void pwm_timer_start(void);
@@ -0,0 +1,58 @@
+#include "retained_state.h"
+
+#include <stddef.h>
+
+#include "nrf.h"
+#include "crc32.h"
+
+// "BLKY"
+#define RETAINED_STATE_MAGIC 0x594B4C42
+
+typedef struct
+{
+    uint32_t magic;
+    HSB_color color;
+    uint32_t crc;
+} retained_block;
+
+// Секция .noinit в области RETAINED blinky_gcc_nrf52.ld (0x20030000, выше RAM
+// приложения): не обнуляется и не копируется при запуске, адрес не зависит от сборки
+static retained_block retained __attribute__((section(".noinit")));
+
+/**
+ * @brief CRC признака и цвета
+ */
+static uint32_t retained_crc(const retained_block *block)
+{
+    return crc32_compute((const uint8_t *)block, offsetof(retained_block, crc), NULL);
+}
+
+bool retained_state_restore(HSB_color *color)
+{
+    // Признаки RESETREAS накапливаются до записи единиц в них: без сброса
+    // включение питания после программного сброса выглядело бы как сброс с
+    // сохранением RAM
+    uint32_t reason = NRF_POWER->RESETREAS;
+    NRF_POWER->RESETREAS = reason;
+
+    // Ни одного признака - включение питания или просадка напряжения
+    if (reason == 0)
+    {
+        return false;
+    }
+
+    if (retained.magic != RETAINED_STATE_MAGIC || retained.crc != retained_crc(&retained))
+    {
+        return false;
+    }
+
+    *color = retained.color;
+    return true;
+}
+
+void retained_state_store(const HSB_color *color)
+{
+    retained.magic = RETAINED_STATE_MAGIC;
+    retained.color = *color;
+    retained.crc = retained_crc(&retained);
+}
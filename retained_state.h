@@ -0,0 +1,32 @@
+#ifndef RETAINED_STATE_H
+#define RETAINED_STATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "led_control.h"
+
+/**
+ * @brief Копия текущего цвета в RAM, не очищаемой при запуске (.noinit)
+ *
+ * RAM сохраняется при программном сбросе, сбросе сторожевым таймером и
+ * возврате из загрузчика DFU, поэтому цвет восстанавливается без чтения
+ * флеш и до инициализации USB и логов. После включения питания содержимое
+ * случайно и отбрасывается по причине сброса, признаку и CRC.
+ * retained_state_restore() сбрасывает NRF_POWER->RESETREAS после чтения.
+ */
+
+/**
+ * @brief Восстановление цвета после сброса без отключения питания
+ * @param color восстановленный цвет
+ * @return false после включения питания или если копия повреждена
+ */
+bool retained_state_restore(HSB_color *color);
+
+/**
+ * @brief Обновление копии цвета
+ * @param color текущий цвет
+ */
+void retained_state_store(const HSB_color *color);
+
+#endif // RETAINED_STATE_H
@@ -0,0 +1,45 @@
+/**
+ * @brief Модуль 64-битного времени RTC
+ */
+
+#include "rtc_clock.h"
+
+#include "app_error.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+
+// Чтение счетчика с запасом чаще переполнения (1024 с при 16384 Гц)
+#define RTC_CLOCK_GUARD_MS 256000
+
+APP_TIMER_DEF(timer_rtc_guard);
+
+static uint64_t clock_ticks = 0;
+static uint32_t clock_last_counter = 0;
+
+static void rtc_clock_guard_handler(void *p_context)
+{
+    (void)rtc_clock_ticks();
+}
+
+void rtc_clock_init(void)
+{
+    clock_ticks = 0;
+    clock_last_counter = app_timer_cnt_get();
+
+    APP_ERROR_CHECK(app_timer_create(&timer_rtc_guard, APP_TIMER_MODE_REPEATED, rtc_clock_guard_handler));
+    APP_ERROR_CHECK(app_timer_start(timer_rtc_guard, APP_TIMER_TICKS(RTC_CLOCK_GUARD_MS), NULL));
+}
+
+uint64_t rtc_clock_ticks(void)
+{
+    uint64_t ticks;
+
+    CRITICAL_REGION_ENTER();
+    uint32_t counter = app_timer_cnt_get();
+    clock_ticks += app_timer_cnt_diff_compute(counter, clock_last_counter);
+    clock_last_counter = counter;
+    ticks = clock_ticks;
+    CRITICAL_REGION_EXIT();
+
+    return ticks;
+}
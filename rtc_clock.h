@@ -0,0 +1,27 @@
+#ifndef RTC_CLOCK_H
+#define RTC_CLOCK_H
+
+#include <stdint.h>
+
+/**
+ * @brief Время по счетчику RTC1 (app_timer), расширенное до 64 бит
+ *
+ * Счетчик RTC 24-битный и при 16384 Гц переполняется каждые 1024 с. Каждое
+ * чтение добавляет прошедшие тики к 64-битному времени, а повторяющийся
+ * таймер читает счетчик чаще периода переполнения, поэтому переполнения не
+ * теряются, даже если другие модули долго не обращаются к часам.
+ */
+
+/**
+ * @brief Запуск часов (app_timer должен быть инициализирован)
+ */
+void rtc_clock_init(void);
+
+/**
+ * @brief Текущее время в тиках APP_TIMER_CLOCK_FREQ с момента rtc_clock_init()
+ *
+ * Можно вызывать из прерываний и из основного цикла.
+ */
+uint64_t rtc_clock_ticks(void);
+
+#endif // RTC_CLOCK_H
@@ -0,0 +1,265 @@
+/**
+ * @brief Эмулятор флеш nRF52840: nrfx_nvmc поверх файла, отображенного в память
+ */
+
+#include "flash_emu.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "nrf.h"
+#include "nrfx_nvmc.h"
+
+#define FLASH_EMU_EMPTY 0xFFFFFFFF
+#define FLASH_EMU_WORDS (FLASH_EMU_SIZE / sizeof(uint32_t))
+#define FLASH_EMU_PAGE_WORDS (FLASH_EMU_PAGE_SIZE / sizeof(uint32_t))
+
+// Счетчики и число записей каждого слова общие для всех перезагрузок
+typedef struct
+{
+    flash_emu_stats stats;
+    uint8_t word_writes[FLASH_EMU_WORDS];
+} flash_emu_shared;
+
+static uint32_t *flash = NULL;
+static flash_emu_shared *shared = NULL;
+
+static int64_t cut_at = -1;
+
+// Текущее частичное стирание
+static uint32_t partial_addr = 0;
+static uint32_t partial_duration_ms = 0;
+static uint32_t partial_elapsed_ms = 0;
+
+static void flash_emu_fault(const char *what, uint32_t addr)
+{
+    fprintf(stderr, "flash_emu: %s at 0x%08x\n", what, (unsigned)addr);
+    fflush(stderr);
+    _exit(FLASH_EMU_FAULT_STATUS);
+}
+
+/**
+ * @brief Время остановки процессора операцией с флеш
+ */
+static void flash_emu_block(uint32_t us)
+{
+    DWT->CYCCNT += us * FLASH_EMU_CPU_MHZ;
+    shared->stats.busy_us += us;
+    if (us > shared->stats.max_block_us)
+    {
+        shared->stats.max_block_us = us;
+    }
+}
+
+/**
+ * @brief Проверка, что операцию нужно прервать отключением питания
+ */
+static bool flash_emu_cut_now(void)
+{
+    return cut_at >= 0 && (int64_t)shared->stats.ops++ == cut_at;
+}
+
+static void flash_emu_power_off(void)
+{
+    msync(flash, FLASH_EMU_SIZE, MS_SYNC);
+    _exit(FLASH_EMU_CUT_STATUS);
+}
+
+/**
+ * @brief Индекс слова в области, с проверкой адреса
+ */
+static uint32_t flash_emu_word_index(uint32_t addr, uint32_t align)
+{
+    if (flash == NULL)
+    {
+        flash_emu_fault("flash not opened", addr);
+    }
+    if (addr < FLASH_EMU_BASE || addr >= FLASH_EMU_BASE + FLASH_EMU_SIZE)
+    {
+        flash_emu_fault("address out of the app data area", addr);
+    }
+    if (addr % align != 0)
+    {
+        flash_emu_fault("unaligned address", addr);
+    }
+    return (addr - FLASH_EMU_BASE) / sizeof(uint32_t);
+}
+
+static void flash_emu_erase(uint32_t index)
+{
+    for (uint32_t i = 0; i < FLASH_EMU_PAGE_WORDS; ++i)
+    {
+        flash[index + i] = FLASH_EMU_EMPTY;
+    }
+    memset(&shared->word_writes[index], 0, FLASH_EMU_PAGE_WORDS);
+    shared->stats.erases[index / FLASH_EMU_PAGE_WORDS]++;
+}
+
+/**
+ * @brief Прерванное стирание: часть слов уже стерта, остальные прежние
+ */
+static void flash_emu_tear_page(uint32_t index)
+{
+    for (uint32_t i = 0; i < FLASH_EMU_PAGE_WORDS; ++i)
+    {
+        if (rand() & 1)
+        {
+            flash[index + i] = FLASH_EMU_EMPTY;
+        }
+    }
+}
+
+void flash_emu_open(const char *path)
+{
+    struct stat st;
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    bool created = st.st_size != FLASH_EMU_SIZE;
+    if (created && ftruncate(fd, FLASH_EMU_SIZE) != 0)
+    {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    void *map = mmap((void *)(uintptr_t)FLASH_EMU_BASE, FLASH_EMU_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_FIXED_NOREPLACE, fd, 0);
+    close(fd);
+    if (map != (void *)(uintptr_t)FLASH_EMU_BASE)
+    {
+        perror("mmap flash");
+        exit(EXIT_FAILURE);
+    }
+    flash = map;
+
+    shared = mmap(NULL, sizeof(*shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED)
+    {
+        perror("mmap stats");
+        exit(EXIT_FAILURE);
+    }
+
+    if (created)
+    {
+        flash_emu_format();
+    }
+}
+
+void flash_emu_format(void)
+{
+    memset(flash, 0xFF, FLASH_EMU_SIZE);
+    memset(shared->word_writes, 0, sizeof(shared->word_writes));
+}
+
+void flash_emu_cut_after(int64_t ops)
+{
+    cut_at = ops;
+    shared->stats.ops = 0;
+}
+
+void flash_emu_read(const volatile uint32_t *addr)
+{
+    (void)addr;
+    shared->stats.words_read++;
+}
+
+void flash_emu_get_stats(flash_emu_stats *stats, bool reset)
+{
+    *stats = shared->stats;
+    if (reset)
+    {
+        memset(&shared->stats, 0, sizeof(shared->stats));
+    }
+}
+
+void nrfx_nvmc_word_write(uint32_t addr, uint32_t value)
+{
+    uint32_t index = flash_emu_word_index(addr, sizeof(uint32_t));
+
+    if ((flash[index] & value) != value)
+    {
+        flash_emu_fault("write would set bits 0 -> 1", addr);
+    }
+    if (++shared->word_writes[index] > FLASH_EMU_WRITES_MAX)
+    {
+        flash_emu_fault("word written too many times since erase", addr);
+    }
+
+    flash_emu_block(FLASH_EMU_WRITE_US);
+    if (flash_emu_cut_now())
+    {
+        // Недописанное слово: сброшена только часть бит
+        flash[index] &= value | (uint32_t)rand();
+        flash_emu_power_off();
+    }
+
+    flash[index] &= value;
+    shared->stats.words_written++;
+}
+
+bool nrfx_nvmc_write_done_check(void)
+{
+    // Запись слова блокирует процессор, к следующему шагу она всегда закончена
+    return true;
+}
+
+nrfx_err_t nrfx_nvmc_page_erase(uint32_t addr)
+{
+    uint32_t index = flash_emu_word_index(addr, FLASH_EMU_PAGE_SIZE);
+
+    flash_emu_block(FLASH_EMU_ERASE_MS * 1000);
+    if (flash_emu_cut_now())
+    {
+        flash_emu_tear_page(index);
+        flash_emu_power_off();
+    }
+
+    flash_emu_erase(index);
+    return NRFX_SUCCESS;
+}
+
+nrfx_err_t nrfx_nvmc_page_partial_erase_init(uint32_t addr, uint32_t duration_ms)
+{
+    if (addr % FLASH_EMU_PAGE_SIZE != 0)
+    {
+        return NRFX_ERROR_INVALID_ADDR;
+    }
+
+    flash_emu_word_index(addr, FLASH_EMU_PAGE_SIZE);
+    partial_addr = addr;
+    partial_duration_ms = duration_ms;
+    partial_elapsed_ms = 0;
+    return NRFX_SUCCESS;
+}
+
+bool nrfx_nvmc_page_partial_erase_continue(void)
+{
+    uint32_t index = flash_emu_word_index(partial_addr, FLASH_EMU_PAGE_SIZE);
+
+    flash_emu_block(partial_duration_ms * 1000);
+    shared->stats.erase_slices++;
+    if (flash_emu_cut_now())
+    {
+        flash_emu_tear_page(index);
+        flash_emu_power_off();
+    }
+
+    partial_elapsed_ms += partial_duration_ms;
+    if (partial_elapsed_ms < FLASH_EMU_ERASE_MS)
+    {
+        return false;
+    }
+
+    flash_emu_erase(index);
+    return true;
+}
@@ -0,0 +1,88 @@
+#ifndef FLASH_EMU_H
+#define FLASH_EMU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "nrf_dfu_types.h"
+
+/**
+ * @brief Эмулятор флеш nRF52840 для сборки nvmc_control.c на хосте
+ *
+ * Область данных приложения - файл, отображенный в память по фиксированному
+ * 32-битному адресу, поэтому содержимое переживает перезапуск процесса так
+ * же, как флеш переживает сброс. Эмулятор проверяет правила NOR: запись
+ * только сбрасывает биты (1 -> 0), слово пишется не больше FLASH_EMU_WRITES_MAX
+ * раз между стираниями, адреса выровнены и лежат в области. Нарушение
+ * завершает процесс с FLASH_EMU_FAULT_STATUS.
+ *
+ * Длительности операций берутся из спецификации nRF52840 и добавляются к
+ * DWT->CYCCNT, поэтому измерения nvmc_control.c на хосте считаются в тех же
+ * тактах, что и на устройстве. Счетчики хранятся в общей памяти и
+ * накапливаются по всем дочерним процессам (перезагрузкам).
+ */
+
+// Адрес области задается при сборке через NVMC_BOOTLOADER_START_ADDR
+#define FLASH_EMU_BASE (NVMC_BOOTLOADER_START_ADDR - NRF_DFU_APP_DATA_AREA_SIZE)
+#define FLASH_EMU_SIZE NRF_DFU_APP_DATA_AREA_SIZE
+#define FLASH_EMU_PAGE_SIZE 0x1000
+#define FLASH_EMU_PAGE_COUNT (FLASH_EMU_SIZE / FLASH_EMU_PAGE_SIZE)
+
+// Предельные значения из спецификации nRF52840 (tWRITE, tERASEPAGE, nWRITE)
+#define FLASH_EMU_WRITE_US 41
+#define FLASH_EMU_ERASE_MS 85
+#define FLASH_EMU_WRITES_MAX 2
+
+#define FLASH_EMU_CPU_MHZ 64
+
+// Код завершения процесса при отключении питания и при нарушении правил флеш
+#define FLASH_EMU_CUT_STATUS 42
+#define FLASH_EMU_FAULT_STATUS 43
+
+typedef struct
+{
+    uint32_t erases[FLASH_EMU_PAGE_COUNT];  // полных стираний каждой страницы
+    uint64_t words_written;
+    uint64_t words_read;        // чтения через flash_emu_read()
+    uint64_t erase_slices;      // частей частичного стирания
+    uint64_t busy_us;           // суммарное время остановки процессора
+    uint32_t max_block_us;      // самая долгая непрерывная остановка
+    uint64_t ops;               // операций записи и стирания с запуска flash_emu_cut_after()
+} flash_emu_stats;
+
+/**
+ * @brief Отображение файла образа флеш в память
+ *
+ * Новый файл заполняется 0xFF, как стертая флеш.
+ * @param path Путь к файлу образа
+ */
+void flash_emu_open(const char *path);
+
+/**
+ * @brief Стирание всей области без учета износа
+ */
+void flash_emu_format(void);
+
+/**
+ * @brief Отключение питания на операции с номером ops
+ *
+ * Операции нумеруются с нуля от вызова. Прерванная запись оставляет слово
+ * с частью несброшенных бит, прерванное стирание - страницу со случайными
+ * стертыми словами, после чего процесс завершается с FLASH_EMU_CUT_STATUS.
+ * @param ops Номер операции, отрицательное значение отключает обрыв
+ */
+void flash_emu_cut_after(int64_t ops);
+
+/**
+ * @brief Учет чтения слова, вызывается модулем через NVMC_READ_HOOK
+ */
+void flash_emu_read(const volatile uint32_t *addr);
+
+/**
+ * @brief Счетчики эмулятора
+ * @param stats Счетчики
+ * @param reset Обнулить счетчики после чтения
+ */
+void flash_emu_get_stats(flash_emu_stats *stats, bool reset);
+
+#endif // FLASH_EMU_H
@@ -0,0 +1,152 @@
+/**
+ * @brief Заглушка app_timer2 на виртуальных часах
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "app_timer.h"
+#include "host_clock.h"
+#include "nrf.h"
+
+#define HOST_CLOCK_TIMERS_MAX 8
+
+static uint64_t now = 0;
+static app_timer_t *timers[HOST_CLOCK_TIMERS_MAX];
+static uint32_t timer_count = 0;
+static host_clock_stats stats;
+
+ret_code_t app_timer_init(void)
+{
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_timer_create(app_timer_id_t const *p_timer_id, app_timer_mode_t mode,
+                            app_timer_timeout_handler_t timeout_handler)
+{
+    app_timer_t *timer = *p_timer_id;
+
+    if (timer_count == HOST_CLOCK_TIMERS_MAX)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    timer->handler = timeout_handler;
+    timer->mode = mode;
+    timer->active = false;
+    timers[timer_count++] = timer;
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void *p_context)
+{
+    if (timeout_ticks < APP_TIMER_MIN_TIMEOUT_TICKS || timeout_ticks > APP_TIMER_MAX_CNT_VAL)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    // Как в app_timer2: повторный запуск активного таймера ничего не меняет
+    if (timer_id->active)
+    {
+        return NRF_SUCCESS;
+    }
+
+    timer_id->p_context = p_context;
+    timer_id->period = timeout_ticks;
+    timer_id->expires = now + timeout_ticks;
+    timer_id->active = true;
+    stats.starts++;
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_timer_stop(app_timer_id_t timer_id)
+{
+    timer_id->active = false;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_cnt_get(void)
+{
+    return (uint32_t)now & APP_TIMER_MAX_CNT_VAL;
+}
+
+uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from)
+{
+    return (ticks_to - ticks_from) & APP_TIMER_MAX_CNT_VAL;
+}
+
+/**
+ * @brief Перевод часов вперед; счетчик тактов DWT идет вместе с ними
+ */
+static void host_clock_set(uint64_t ticks)
+{
+    uint64_t cycles_before = now * SystemCoreClock / APP_TIMER_CLOCK_FREQ;
+    uint64_t cycles_after = ticks * SystemCoreClock / APP_TIMER_CLOCK_FREQ;
+
+    DWT->CYCCNT += (uint32_t)(cycles_after - cycles_before);
+    now = ticks;
+}
+
+uint64_t host_clock_now(void)
+{
+    return now;
+}
+
+uint64_t host_clock_next_timeout(void)
+{
+    uint64_t next = UINT64_MAX;
+
+    for (uint32_t i = 0; i < timer_count; ++i)
+    {
+        if (timers[i]->active && timers[i]->expires < next)
+        {
+            next = timers[i]->expires;
+        }
+    }
+    return next;
+}
+
+void host_clock_run_until(uint64_t ticks)
+{
+    uint64_t next;
+
+    while ((next = host_clock_next_timeout()) <= ticks)
+    {
+        app_timer_t *timer = NULL;
+
+        for (uint32_t i = 0; i < timer_count && timer == NULL; ++i)
+        {
+            if (timers[i]->active && timers[i]->expires == next)
+            {
+                timer = timers[i];
+            }
+        }
+
+        host_clock_set(next);
+        if (timer->mode == APP_TIMER_MODE_REPEATED)
+        {
+            timer->expires += timer->period;
+        }
+        else
+        {
+            timer->active = false;
+        }
+
+        stats.timeouts++;
+        timer->handler(timer->p_context);
+    }
+
+    if (ticks > now)
+    {
+        host_clock_set(ticks);
+    }
+}
+
+void host_clock_get_stats(host_clock_stats *result, bool reset)
+{
+    *result = stats;
+    if (reset)
+    {
+        stats = (host_clock_stats){0};
+    }
+}
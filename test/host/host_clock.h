@@ -0,0 +1,39 @@
+#ifndef HOST_CLOCK_H
+#define HOST_CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Виртуальные часы RTC1 для заглушки app_timer
+ *
+ * Счетчик 64-битный, app_timer_cnt_get() отдает младшие 24 бита, как RTC.
+ * Время идет только по host_clock_run_until(): сроки таймеров обрабатываются
+ * по порядку, перед каждым обработчиком часы стоят на его сроке. Счетчик
+ * тактов DWT->CYCCNT идет вместе с часами на SystemCoreClock.
+ */
+
+typedef struct
+{
+    uint32_t starts;   // app_timer_start() активного или остановленного таймера
+    uint32_t timeouts; // вызовов обработчиков
+} host_clock_stats;
+
+/**
+ * @brief Текущее время в тиках APP_TIMER_CLOCK_FREQ
+ */
+uint64_t host_clock_now(void);
+
+/**
+ * @brief Продвинуть часы до момента ticks, вызывая истекшие таймеры
+ */
+void host_clock_run_until(uint64_t ticks);
+
+/**
+ * @brief Ближайший срок активного таймера, UINT64_MAX - нет таймеров
+ */
+uint64_t host_clock_next_timeout(void);
+
+void host_clock_get_stats(host_clock_stats *stats, bool reset);
+
+#endif // HOST_CLOCK_H
@@ -0,0 +1,70 @@
+/**
+ * @brief Заглушки nrf_gpio и nrfx_gpiote: уровни выводов в памяти
+ */
+
+#include <stddef.h>
+
+#include "host_gpio.h"
+#include "nrfx_gpiote.h"
+
+static bool pin_low[NUMBER_OF_PINS];
+static nrfx_gpiote_evt_handler_t pin_handlers[NUMBER_OF_PINS];
+static bool pin_enabled[NUMBER_OF_PINS];
+static bool gpiote_initialized = false;
+
+uint32_t nrf_gpio_pin_read(uint32_t pin_number)
+{
+    return pin_number < NUMBER_OF_PINS && !pin_low[pin_number];
+}
+
+nrfx_err_t nrfx_gpiote_init(void)
+{
+    if (gpiote_initialized)
+    {
+        return NRFX_ERROR_INVALID_STATE;
+    }
+    gpiote_initialized = true;
+    return NRFX_SUCCESS;
+}
+
+bool nrfx_gpiote_is_init(void)
+{
+    return gpiote_initialized;
+}
+
+nrfx_err_t nrfx_gpiote_in_init(nrfx_gpiote_pin_t pin, nrfx_gpiote_in_config_t const *p_config,
+                               nrfx_gpiote_evt_handler_t evt_handler)
+{
+    // Как в драйвере: вывод уже занят
+    if (pin >= NUMBER_OF_PINS || pin_handlers[pin] != NULL)
+    {
+        return NRFX_ERROR_INVALID_STATE;
+    }
+
+    pin_handlers[pin] = evt_handler;
+    return NRFX_SUCCESS;
+}
+
+void nrfx_gpiote_in_event_enable(nrfx_gpiote_pin_t pin, bool int_enable)
+{
+    pin_enabled[pin] = int_enable;
+}
+
+uint32_t nrfx_gpiote_in_event_addr_get(nrfx_gpiote_pin_t pin)
+{
+    return 0;
+}
+
+void host_gpio_set(uint32_t pin, bool high)
+{
+    if (pin_low[pin] == !high)
+    {
+        return;
+    }
+
+    pin_low[pin] = !high;
+    if (pin_handlers[pin] != NULL && pin_enabled[pin])
+    {
+        pin_handlers[pin](pin, NRF_GPIOTE_POLARITY_TOGGLE);
+    }
+}
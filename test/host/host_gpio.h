@@ -0,0 +1,21 @@
+#ifndef HOST_GPIO_H
+#define HOST_GPIO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Уровни выводов для заглушек nrf_gpio и nrfx_gpiote
+ *
+ * Выводы по умолчанию подтянуты вверх. Смена уровня вызывает обработчик
+ * GPIOTE вывода в том же потоке, как прерывание, если событие включено.
+ */
+
+/**
+ * @brief Установить уровень вывода
+ * @param pin  Номер вывода
+ * @param high true - высокий уровень
+ */
+void host_gpio_set(uint32_t pin, bool high);
+
+#endif // HOST_GPIO_H
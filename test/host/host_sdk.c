@@ -0,0 +1,43 @@
+/**
+ * @brief Реализации функций SDK для сборки модулей на хосте
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "app_error.h"
+#include "crc32.h"
+#include "host_test.h"
+#include "nrf.h"
+
+DWT_Type host_dwt;
+CoreDebug_Type host_core_debug;
+uint32_t SystemCoreClock = 64000000;
+
+uint64_t host_crc32_bytes = 0;
+
+uint32_t crc32_compute(uint8_t const *p_data, uint32_t size, uint32_t const *p_crc)
+{
+    // Побитовый расчет, как в components/libraries/crc32
+    uint32_t crc = (p_crc == NULL) ? 0xFFFFFFFF : ~(*p_crc);
+
+    for (uint32_t i = 0; i < size; i++)
+    {
+        crc = crc ^ p_data[i];
+        for (uint32_t j = 8; j > 0; j--)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320U & ((crc & 1) ? 0xFFFFFFFF : 0));
+        }
+    }
+
+    host_crc32_bytes += size;
+    return ~crc;
+}
+
+void host_app_error(uint32_t error_code, const char *file, int line)
+{
+    fprintf(stderr, "%s:%d: APP_ERROR_CHECK failed: 0x%X\n", file, line, error_code);
+    fflush(stdout);
+    _exit(HOST_APP_ERROR_STATUS);
+}
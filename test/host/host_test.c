@@ -0,0 +1,43 @@
+#include "host_test.h"
+
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int host_failures = 0;
+
+int host_boot(host_boot_entry entry, void *context)
+{
+    int status;
+
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (pid == 0)
+    {
+        // Ошибки прежних загрузок уже учтены родителем
+        host_failures = 0;
+        entry(context);
+        fflush(stdout);
+        _exit(host_failures ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+    {
+        host_failures++;
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+int host_test_result(const char *name)
+{
+    printf("%s: %s\n", name, host_failures ? "FAIL" : "OK");
+    return host_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,45 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Общие средства тестов на хосте
+ *
+ * Каждая перезагрузка устройства - отдельный дочерний процесс: статические
+ * переменные модулей начинаются с нуля, а флеш (файл в памяти) и счетчики
+ * эмулятора общие.
+ */
+
+extern int host_failures;
+
+// Байт, обработанных crc32_compute(), для оценки стоимости проверок
+extern uint64_t host_crc32_bytes;
+
+#define CHECK(cond)                                                                  \
+    do                                                                               \
+    {                                                                                \
+        if (!(cond))                                                                 \
+        {                                                                            \
+            host_failures++;                                                         \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+        }                                                                            \
+    } while (0)
+
+typedef void (*host_boot_entry)(void *context);
+
+/**
+ * @brief Одна загрузка устройства в дочернем процессе
+ * @param entry   Код загрузки
+ * @param context Параметр для entry
+ * @return Код завершения: 0 - без ошибок CHECK, FLASH_EMU_CUT_STATUS - отключение питания
+ */
+int host_boot(host_boot_entry entry, void *context);
+
+/**
+ * @brief Итог теста для возврата из main()
+ */
+int host_test_result(const char *name);
+
+#endif // HOST_TEST_H
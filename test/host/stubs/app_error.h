@@ -0,0 +1,24 @@
+#ifndef APP_ERROR_H__
+#define APP_ERROR_H__
+
+// Заглушка: ошибка завершает загрузку с кодом HOST_APP_ERROR_STATUS
+
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#define HOST_APP_ERROR_STATUS 44
+
+void host_app_error(uint32_t error_code, const char *file, int line) __attribute__((noreturn));
+
+#define APP_ERROR_CHECK(ERR_CODE)                                 \
+    do                                                            \
+    {                                                             \
+        const uint32_t LOCAL_ERR_CODE = (ERR_CODE);               \
+        if (LOCAL_ERR_CODE != NRF_SUCCESS)                        \
+        {                                                         \
+            host_app_error(LOCAL_ERR_CODE, __FILE__, __LINE__);   \
+        }                                                         \
+    } while (0)
+
+#endif // APP_ERROR_H__
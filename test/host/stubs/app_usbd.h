@@ -0,0 +1,6 @@
+#ifndef APP_USBD_H__
+#define APP_USBD_H__
+
+// Заглушка: модули подключают заголовок, но его функции не вызывают
+
+#endif // APP_USBD_H__
@@ -0,0 +1,6 @@
+#ifndef APP_USBD_SERIAL_NUM_H__
+#define APP_USBD_SERIAL_NUM_H__
+
+// Заглушка: модули подключают заголовок, но его функции не вызывают
+
+#endif // APP_USBD_SERIAL_NUM_H__
@@ -0,0 +1,15 @@
+#ifndef APP_UTIL_H__
+#define APP_UTIL_H__
+
+// Заглушка макросов app_util для сборки на хосте
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define STATIC_ASSERT(expr, ...) _Static_assert(expr, "static assertion failed: " #expr)
+#define CONTAINER_OF(ptr, type, member) ((type *)(((char *)(ptr)) - offsetof(type, member)))
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
+#define UNUSED_VARIABLE(x) ((void)(x))
+#define UNUSED_PARAMETER(x) ((void)(x))
+
+#endif // APP_UTIL_H__
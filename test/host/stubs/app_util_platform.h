@@ -0,0 +1,12 @@
+#ifndef APP_UTIL_PLATFORM_H__
+#define APP_UTIL_PLATFORM_H__
+
+// Заглушка: тесты однопоточные, прерывания вызываются из того же потока
+
+#include "app_util.h"
+#include "nrf.h"
+
+#define CRITICAL_REGION_ENTER() {
+#define CRITICAL_REGION_EXIT() }
+
+#endif // APP_UTIL_PLATFORM_H__
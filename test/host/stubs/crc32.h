@@ -0,0 +1,10 @@
+#ifndef CRC32_H__
+#define CRC32_H__
+
+// Заглушка модуля crc32 SDK, реализация в host_sdk.c
+
+#include <stdint.h>
+
+uint32_t crc32_compute(uint8_t const *p_data, uint32_t size, uint32_t const *p_crc);
+
+#endif // CRC32_H__
@@ -0,0 +1,31 @@
+#ifndef NRF_H
+#define NRF_H
+
+// Заглушка регистров ядра для сборки на хосте. Счетчик тактов DWT
+// продвигают эмуляторы периферии, а не реальное время хоста
+
+#include <stdint.h>
+
+typedef struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+extern DWT_Type host_dwt;
+extern CoreDebug_Type host_core_debug;
+extern uint32_t SystemCoreClock;
+
+#define DWT (&host_dwt)
+#define CoreDebug (&host_core_debug)
+#define DWT_CTRL_CYCCNTENA_Msk (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+
+#define __DMB() __sync_synchronize()
+
+#endif // NRF_H
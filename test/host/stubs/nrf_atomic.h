@@ -0,0 +1,13 @@
+#ifndef NRF_ATOMIC_H__
+#define NRF_ATOMIC_H__
+
+#include <stdint.h>
+
+typedef volatile uint32_t nrf_atomic_u32_t;
+
+static inline uint32_t nrf_atomic_u32_fetch_add(nrf_atomic_u32_t *p_data, uint32_t value)
+{
+    return __atomic_fetch_add(p_data, value, __ATOMIC_SEQ_CST);
+}
+
+#endif // NRF_ATOMIC_H__
@@ -0,0 +1,6 @@
+#ifndef NRF_BOOTLOADER_INFO_H__
+#define NRF_BOOTLOADER_INFO_H__
+
+// Заглушка: адрес загрузчика задается через NVMC_BOOTLOADER_START_ADDR в Makefile
+
+#endif // NRF_BOOTLOADER_INFO_H__
@@ -0,0 +1,9 @@
+#ifndef NRF_DFU_TYPES_H__
+#define NRF_DFU_TYPES_H__
+
+// Заглушка: размер области данных приложения как в sdk_config загрузчика
+
+#define CODE_PAGE_SIZE 0x1000
+#define NRF_DFU_APP_DATA_AREA_SIZE (CODE_PAGE_SIZE * 3)
+
+#endif // NRF_DFU_TYPES_H__
@@ -0,0 +1,20 @@
+#ifndef NRF_GPIO_H__
+#define NRF_GPIO_H__
+
+// Заглушка выводов GPIO: уровни задает тест через host_gpio.h
+
+#include <stdint.h>
+
+#define NUMBER_OF_PINS 48
+#define NRF_GPIO_PIN_MAP(port, pin) (((port) << 5) | ((pin) & 0x1F))
+
+typedef enum
+{
+    NRF_GPIO_PIN_NOPULL = 0,
+    NRF_GPIO_PIN_PULLDOWN = 1,
+    NRF_GPIO_PIN_PULLUP = 3
+} nrf_gpio_pin_pull_t;
+
+uint32_t nrf_gpio_pin_read(uint32_t pin_number);
+
+#endif // NRF_GPIO_H__
@@ -0,0 +1,6 @@
+#ifndef NRF_LOG_CTRL_H__
+#define NRF_LOG_CTRL_H__
+
+// Заглушка: модули подключают заголовок, но его функции не вызывают
+
+#endif // NRF_LOG_CTRL_H__
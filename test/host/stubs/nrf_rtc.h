@@ -0,0 +1,7 @@
+#ifndef NRF_RTC_H__
+#define NRF_RTC_H__
+
+// Заглушка: периферия нужна только при BUTTON_HW_DEBOUNCE=1, на хосте этот
+// режим не собирается
+
+#endif // NRF_RTC_H__
@@ -0,0 +1,24 @@
+#ifndef NRFX_ERRORS_H__
+#define NRFX_ERRORS_H__
+
+// Заглушка кодов ошибок nrfx для сборки на хосте. Как в SDK, коды совпадают
+// с NRF_ERROR_*, поэтому результат nrfx проверяется APP_ERROR_CHECK
+
+typedef enum
+{
+    NRFX_SUCCESS = 0,
+    NRFX_ERROR_INTERNAL = 3,
+    NRFX_ERROR_NO_MEM = 4,
+    NRFX_ERROR_NOT_SUPPORTED = 6,
+    NRFX_ERROR_INVALID_PARAM = 7,
+    NRFX_ERROR_INVALID_STATE = 8,
+    NRFX_ERROR_INVALID_LENGTH = 9,
+    NRFX_ERROR_TIMEOUT = 13,
+    NRFX_ERROR_NULL = 14,
+    NRFX_ERROR_FORBIDDEN = 15,
+    NRFX_ERROR_INVALID_ADDR = 16,
+    NRFX_ERROR_BUSY = 17,
+    NRFX_ERROR_ALREADY_INITIALIZED = 0x8005
+} nrfx_err_t;
+
+#endif // NRFX_ERRORS_H__
@@ -0,0 +1,21 @@
+#ifndef NRFX_NVMC_H__
+#define NRFX_NVMC_H__
+
+// Заглушка драйвера nrfx_nvmc, реализация в flash_emu.c
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "nrfx_errors.h"
+
+void nrfx_nvmc_word_write(uint32_t address, uint32_t value);
+bool nrfx_nvmc_write_done_check(void);
+nrfx_err_t nrfx_nvmc_page_erase(uint32_t address);
+nrfx_err_t nrfx_nvmc_page_partial_erase_init(uint32_t address, uint32_t duration_ms);
+bool nrfx_nvmc_page_partial_erase_continue(void);
+
+// Учет чтений эмулятором, подставляется в модуль через NVMC_READ_HOOK
+void flash_emu_read(const volatile uint32_t *addr);
+
+#endif // NRFX_NVMC_H__
@@ -0,0 +1,7 @@
+#ifndef NRFX_PPI_H__
+#define NRFX_PPI_H__
+
+// Заглушка: периферия нужна только при BUTTON_HW_DEBOUNCE=1, на хосте этот
+// режим не собирается
+
+#endif // NRFX_PPI_H__
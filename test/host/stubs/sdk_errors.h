@@ -0,0 +1,13 @@
+#ifndef SDK_ERRORS_H__
+#define SDK_ERRORS_H__
+
+#include <stdint.h>
+
+typedef uint32_t ret_code_t;
+
+#define NRF_SUCCESS 0
+#define NRF_ERROR_INVALID_STATE 8
+#define NRF_ERROR_NO_MEM 4
+#define NRF_ERROR_INVALID_PARAM 7
+
+#endif // SDK_ERRORS_H__
@@ -0,0 +1,193 @@
+/**
+ * @brief Автомат кнопки button_fsm с одним таймером: операции таймера на
+ * серию дребезга и события кликов и долгого нажатия
+ *
+ * Таймер моделируется так же, как в button_handler.c: button_fsm_schedule()
+ * решает, запускать ли его, срабатывание обрабатывает наступившие сроки.
+ * Время - тики app_timer (16384 Гц).
+ */
+
+#include <string.h>
+
+#include "button_fsm.h"
+#include "host_test.h"
+
+#define TEST_TICKS(ms) ((uint32_t)(((uint64_t)(ms) * 16384 + 500) / 1000))
+#define TEST_MIN_TIMEOUT 5
+#define TEST_BOUNCE_MAX 32
+#define TEST_EVENTS_MAX 256
+
+static button_fsm_t fsm;
+static button_fsm_timer_t timer;
+
+static struct
+{
+    bool armed;
+    uint32_t expires;
+    uint32_t starts;
+} hw_timer;
+
+static bool level = false;
+static button_fsm_event events[TEST_EVENTS_MAX];
+static uint8_t clicks[TEST_EVENTS_MAX];
+static uint32_t event_count = 0;
+
+static void on_event(button_fsm_t *sender, button_fsm_event event)
+{
+    if (event_count < TEST_EVENTS_MAX)
+    {
+        clicks[event_count] = sender->click_counter;
+        events[event_count++] = event;
+    }
+}
+
+static void schedule(uint32_t now)
+{
+    uint32_t timeout;
+
+    switch (button_fsm_schedule(&timer, &fsm, now, TEST_MIN_TIMEOUT, &timeout))
+    {
+    case BUTTON_FSM_TIMER_RESTART:
+    case BUTTON_FSM_TIMER_START:
+        hw_timer.armed = true;
+        hw_timer.expires = now + timeout;
+        hw_timer.starts++;
+        break;
+
+    case BUTTON_FSM_TIMER_KEEP:
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Срабатывания таймера до момента now включительно
+ */
+static void run_until(uint32_t now)
+{
+    while (hw_timer.armed && (int32_t)(now - hw_timer.expires) >= 0)
+    {
+        uint32_t fired = hw_timer.expires;
+        uint32_t deadline;
+
+        hw_timer.armed = false;
+        button_fsm_timer_expired(&timer);
+        button_fsm_process(&fsm, fired, level);
+        if (button_fsm_next_deadline(&fsm, &deadline))
+        {
+            schedule(fired);
+        }
+    }
+}
+
+static void edge(uint32_t now, bool pressed)
+{
+    run_until(now);
+    level = pressed;
+    button_fsm_edge(&fsm, now);
+    schedule(now);
+}
+
+static void reset(void)
+{
+    button_fsm_config_t config = {
+        .debounce_ticks = TEST_TICKS(50),
+        .double_click_ticks = TEST_TICKS(500),
+        .long_press_ticks = TEST_TICKS(1000),
+        .repeat_ticks = TEST_TICKS(30)};
+
+    button_fsm_init(&fsm, &config, on_event);
+    memset(&timer, 0, sizeof(timer));
+    memset(&hw_timer, 0, sizeof(hw_timer));
+    level = false;
+    event_count = 0;
+}
+
+static uint32_t count(button_fsm_event event)
+{
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < event_count; ++i)
+    {
+        n += events[i] == event;
+    }
+    return n;
+}
+
+/**
+ * @brief Нажатие с дребезгом из bounces фронтов за 5 мс
+ *
+ * @return Запусков таймера от первого фронта до окончания антидребезга,
+ * включая срок долгого нажатия после PRESS
+ */
+static uint32_t bounced_press(uint32_t start, uint32_t bounces)
+{
+    hw_timer.starts = 0;
+
+    // Нечетное число фронтов оставляет кнопку нажатой
+    for (uint32_t i = 0; i < 2 * bounces + 1; ++i)
+    {
+        edge(start + i * TEST_TICKS(5) / (2 * bounces + 1), i % 2 == 0);
+    }
+    run_until(start + TEST_TICKS(5) + TEST_TICKS(50));
+    return hw_timer.starts;
+}
+
+int main(void)
+{
+    // Серия дребезга отодвигает срок, но таймер перезапускается не на каждом фронте
+    printf("  press bounce: edges -> timer starts until debounced (with the long-press deadline)\n");
+    for (uint32_t bounces = 0; bounces <= TEST_BOUNCE_MAX; bounces = bounces ? bounces * 2 : 1)
+    {
+        reset();
+        uint32_t starts = bounced_press(1000, bounces);
+
+        printf("    %2u -> %u\n", 2 * bounces + 1, starts);
+        // Без дребезга таймер не срабатывает раньше срока, с дребезгом - один раз
+        CHECK(starts == (bounces ? 3 : 2));
+        CHECK(count(BUTTON_FSM_EVT_PRESS) == 1);
+    }
+
+    // Клик: нажатие, отпускание, окно кликов закрывается после отпускания
+    reset();
+    edge(1000, true);
+    edge(1000 + TEST_TICKS(150), false);
+    run_until(1000 + TEST_TICKS(2000));
+    CHECK(event_count == 3 && events[0] == BUTTON_FSM_EVT_PRESS && events[1] == BUTTON_FSM_EVT_RELEASE &&
+          events[2] == BUTTON_FSM_EVT_CLICK_TIMEOUT);
+    CHECK(clicks[2] == 1);
+    CHECK(!hw_timer.armed);
+
+    // Двойной клик: оба нажатия до закрытия окна
+    reset();
+    edge(1000, true);
+    edge(1000 + TEST_TICKS(120), false);
+    edge(1000 + TEST_TICKS(250), true);
+    edge(1000 + TEST_TICKS(370), false);
+    run_until(1000 + TEST_TICKS(2000));
+    CHECK(count(BUTTON_FSM_EVT_PRESS) == 2 && count(BUTTON_FSM_EVT_CLICK_TIMEOUT) == 1);
+    CHECK(events[event_count - 1] == BUTTON_FSM_EVT_CLICK_TIMEOUT && clicks[event_count - 1] == 2);
+
+    // Нажатие после окна - снова одиночный клик
+    reset();
+    edge(1000, true);
+    edge(1000 + TEST_TICKS(120), false);
+    edge(1000 + TEST_TICKS(700), true);
+    run_until(1000 + TEST_TICKS(800));
+    CHECK(events[event_count - 1] == BUTTON_FSM_EVT_PRESS && clicks[event_count - 1] == 1);
+
+    // Долгое нажатие: через 1 с после антидребезга, затем повтор каждые 30 мс
+    reset();
+    edge(1000, true);
+    run_until(1000 + TEST_TICKS(50) + TEST_TICKS(1000) + TEST_TICKS(300));
+    uint32_t repeats = count(BUTTON_FSM_EVT_LONG_REPEAT);
+    edge(1000 + TEST_TICKS(1400), false);
+    run_until(1000 + TEST_TICKS(3000));
+    printf("  long press: %u repeats in 300 ms of hold, %u timer starts in total\n", repeats, hw_timer.starts);
+    CHECK(count(BUTTON_FSM_EVT_LONG_PRESS) == 1);
+    CHECK(repeats == TEST_TICKS(300) / TEST_TICKS(30));
+    // Удержание не разрывает серию: окно кликов закрывается после отпускания
+    CHECK(count(BUTTON_FSM_EVT_CLICK_TIMEOUT) == 1);
+    CHECK(!hw_timer.armed);
+
+    return host_test_result("test_button_fsm");
+}
@@ -0,0 +1,361 @@
+/**
+ * @brief Воспроизведение записанных фронтов кнопки через button_handler.c
+ *
+ * button_handler.c, button_fsm.c и button_gesture.c собираются без изменений
+ * поверх заглушек GPIOTE (host_gpio.c) и app_timer на виртуальных часах
+ * (host_clock.c). Каждая трасса из каталога traces идет в отдельной загрузке.
+ *
+ * Формат трассы: строки "<время, мс> <уровень>" (1 - нажата, 0 - отпущена)
+ * по возрастанию времени и строка "expect <жесты>" - ожидаемые жесты по
+ * порядку, повторы удержания считаются одним жестом. '#' - комментарий.
+ *
+ * Основной цикл моделируется как в main.c: button_process() после каждого
+ * прерывания, затем кадр вывода на ШИМ. Для каждого жеста выводится задержка
+ * от последнего фронта. Метки фронтов в журнале кнопок должны совпасть со
+ * временем фронтов трассы.
+ *
+ * Пробуждение основного цикла, действие жеста, расчет кадра и период ШИМ
+ * добавляют к DWT->CYCCNT заданную стоимость, не сдвигая часы app_timer.
+ * Трассы задержки жестов должны завершиться, а каждый этап - показать ровно
+ * сумму стоимостей до него: окно кликов и время удержания в задержку не входят.
+ *
+ * Вариант test_button_replay_irq собирается с BUTTON_DISPATCH_FROM_IRQ=1 и
+ * должен дать те же жесты; диспетчеризация в нем идет без ожидания основного
+ * цикла. Длительность прерываний выводится в нс хоста: действия жестов здесь
+ * пустые, поэтому разница вариантов на хосте мала, а такты nRF52840 она не
+ * заменяет (на устройстве - команда IRQMAX).
+ */
+
+#include <glob.h>
+#include <string.h>
+#include <time.h>
+
+#include "app_timer.h"
+#include "app_util.h"
+#include "button_handler.h"
+#include "host_clock.h"
+#include "host_gpio.h"
+#include "host_test.h"
+#include "latency_trace.h"
+#include "nrf.h"
+#include "rtc_clock.h"
+
+#define TEST_EDGES_MAX 256
+#define TEST_GESTURES_MAX 64
+#define TEST_NAME_SIZE 16
+#define TEST_LINE_SIZE 256
+// Время после последнего фронта, за которое закрываются все окна автомата
+#define TEST_TAIL_MS 3000
+// Стоимость этапов трассы задержки в мкс: пробуждение основного цикла,
+// действие жеста, расчет кадра и ожидание перезагрузки ШИМ
+#define TEST_LOOP_US 20
+#define TEST_ACTION_US 100
+#define TEST_DISPLAY_US 200
+#define TEST_PWM_US 1000
+
+// Значение по умолчанию из button_handler.c
+#ifndef BUTTON_DISPATCH_FROM_IRQ
+#define BUTTON_DISPATCH_FROM_IRQ 0
+#endif
+
+typedef struct
+{
+    const char *path;
+    uint32_t edge_count;
+    uint64_t edge_ticks[TEST_EDGES_MAX];
+    bool edge_pressed[TEST_EDGES_MAX];
+    char expected[TEST_LINE_SIZE];
+} test_trace;
+
+static const char *gesture_names[TEST_GESTURES_MAX];
+static uint64_t gesture_ticks[TEST_GESTURES_MAX];
+static uint32_t gesture_count = 0;
+static uint64_t irq_max_ns = 0;
+
+/**
+ * @brief Учет времени работы процессора без сдвига часов app_timer
+ */
+static void charge_us(uint32_t us)
+{
+    DWT->CYCCNT += us * (SystemCoreClock / 1000000);
+}
+
+static void record(const char *name)
+{
+    charge_us(TEST_ACTION_US);
+    if (gesture_count < TEST_GESTURES_MAX)
+    {
+        gesture_names[gesture_count] = name;
+        gesture_ticks[gesture_count] = host_clock_now();
+        gesture_count++;
+    }
+}
+
+static void on_press(void)
+{
+    record("press");
+}
+
+static void on_double(void)
+{
+    record("double");
+}
+
+static void on_triple(void)
+{
+    record("triple");
+}
+
+static void on_long(void)
+{
+    static uint64_t last = 0;
+    uint64_t now = host_clock_now();
+
+    // Повтор удержания - тот же жест
+    bool repeat = gesture_count > 0 && strcmp(gesture_names[gesture_count - 1], "long") == 0 &&
+                  now - last <= 2 * APP_TIMER_TICKS(30);
+    last = now;
+    if (!repeat)
+    {
+        record("long");
+    }
+    else
+    {
+        charge_us(TEST_ACTION_US);
+    }
+}
+
+static void on_click_hold(void)
+{
+    record("click_hold");
+}
+
+static void on_tap_tempo(void)
+{
+    record("tap_tempo");
+}
+
+// Те же шаблоны, что blinky_gestures в main.c (там нажатие - удар только во
+// время сеанса tap-tempo)
+static const gesture_pattern test_gestures[] = {
+    {.presses = 0, .flags = GESTURE_FLAG_IMMEDIATE, .action = on_press},
+    {.presses = 2, .action = on_double},
+    {.presses = 3, .action = on_triple},
+    {.presses = 1, .hold_ms = 1000, .flags = GESTURE_FLAG_REPEAT, .action = on_long},
+    {.presses = 2, .hold_ms = 1000, .action = on_click_hold},
+    {.presses = 3, .hold_ms = 1000, .action = on_tap_tempo},
+};
+
+static const button_config_t test_buttons[] = {
+    {.pin = BUTTON_PIN, .gestures = test_gestures, .gesture_count = ARRAY_SIZE(test_gestures)},
+};
+
+static bool load(const char *path, test_trace *trace)
+{
+    char line[TEST_LINE_SIZE];
+    FILE *file = fopen(path, "r");
+
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    memset(trace, 0, sizeof(*trace));
+    trace->path = path;
+    while (fgets(line, sizeof(line), file))
+    {
+        double ms;
+        int pressed;
+
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '#' || line[0] == '\0')
+        {
+            continue;
+        }
+        if (strncmp(line, "expect", 6) == 0)
+        {
+            snprintf(trace->expected, sizeof(trace->expected), "%s", line[6] == ' ' ? line + 7 : "");
+        }
+        else if (sscanf(line, "%lf %d", &ms, &pressed) == 2 && trace->edge_count < TEST_EDGES_MAX)
+        {
+            trace->edge_ticks[trace->edge_count] = (uint64_t)(ms * APP_TIMER_CLOCK_FREQ / 1000 + 0.5);
+            trace->edge_pressed[trace->edge_count] = pressed;
+            trace->edge_count++;
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+static uint64_t host_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void irq_measure(uint64_t start)
+{
+    uint64_t ns = host_ns() - start;
+    if (ns > irq_max_ns)
+    {
+        irq_max_ns = ns;
+    }
+}
+
+/**
+ * @brief Проход основного цикла: события кнопок и кадр ШИМ, если его ждет трасса
+ */
+static void main_loop_pass(void)
+{
+    charge_us(TEST_LOOP_US);
+    button_process();
+    if (latency_trace_waiting(LATENCY_STAGE_DISPLAY))
+    {
+        charge_us(TEST_DISPLAY_US);
+        latency_trace_mark(LATENCY_STAGE_DISPLAY);
+        charge_us(TEST_PWM_US);
+        latency_trace_mark(LATENCY_STAGE_PWM_RELOAD);
+    }
+}
+
+/**
+ * @brief Задержки этапов завершенных трасс против модели стоимости
+ */
+static void check_latency(void)
+{
+    // Этапы после антидребезга считаются от события автомата; при
+    // диспетчеризации из прерывания основной цикл ждет только кадр
+    uint32_t dispatch_us = BUTTON_DISPATCH_FROM_IRQ ? 0 : TEST_LOOP_US;
+    uint32_t update_us = dispatch_us + TEST_ACTION_US;
+    uint32_t display_us = TEST_LOOP_US + TEST_ACTION_US + TEST_DISPLAY_US;
+    const uint32_t expected[LATENCY_STAGE_COUNT] = {
+        [LATENCY_STAGE_DISPATCH] = dispatch_us,
+        [LATENCY_STAGE_UPDATE] = update_us,
+        [LATENCY_STAGE_DISPLAY] = display_us,
+        [LATENCY_STAGE_PWM_RELOAD] = display_us + TEST_PWM_US,
+    };
+    latency_histogram histogram;
+
+    latency_trace_get(LATENCY_STAGE_DEBOUNCE, &histogram);
+    printf("    latency traces: %u completed, debounce %u us", histogram.count, histogram.max_us);
+    CHECK(histogram.count == 0 || histogram.max_us > 0);
+
+    for (uint8_t stage = LATENCY_STAGE_DISPATCH; stage < LATENCY_STAGE_COUNT; ++stage)
+    {
+        latency_trace_get(stage, &histogram);
+        printf(", %s %u us", latency_trace_stage_name(stage), histogram.max_us);
+        CHECK(histogram.count == 0 || histogram.max_us == expected[stage]);
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Основной цикл до момента ticks: проход цикла после каждого таймера
+ */
+static void run_until(uint64_t ticks)
+{
+    uint64_t next;
+
+    while ((next = host_clock_next_timeout()) <= ticks)
+    {
+        uint64_t start = host_ns();
+        host_clock_run_until(next);
+        irq_measure(start);
+        main_loop_pass();
+    }
+    host_clock_run_until(ticks);
+}
+
+/**
+ * @brief Метки фронтов в журнале кнопок против времени фронтов трассы
+ */
+static void check_log(const test_trace *trace)
+{
+    button_log_entry entries[BUTTON_LOG_SIZE];
+    uint8_t count = button_log_read(entries);
+    uint32_t edge = trace->edge_count;
+
+    // Журнал хранит последние записи: сверка от конца
+    for (uint8_t i = count; i > 0 && edge > 0; --i)
+    {
+        if (entries[i - 1].type == BUTTON_LOG_EDGE)
+        {
+            edge--;
+            CHECK(entries[i - 1].ticks == (uint32_t)trace->edge_ticks[edge]);
+            CHECK(entries[i - 1].value == trace->edge_pressed[edge]);
+        }
+    }
+}
+
+static void replay(void *context)
+{
+    const test_trace *trace = context;
+    char result[TEST_LINE_SIZE] = "";
+    host_clock_stats clock;
+    uint32_t edges;
+    uint32_t wakeups;
+    uint32_t edge = 0;
+
+    rtc_clock_init();
+    button_init(test_buttons, ARRAY_SIZE(test_buttons));
+    host_clock_get_stats(&clock, true);
+
+    for (uint32_t i = 0; i < trace->edge_count; ++i)
+    {
+        run_until(trace->edge_ticks[i]);
+        uint64_t start = host_ns();
+        host_gpio_set(BUTTON_PIN, !trace->edge_pressed[i]);
+        irq_measure(start);
+        main_loop_pass();
+    }
+    run_until(host_clock_now() + APP_TIMER_TICKS(TEST_TAIL_MS));
+
+    button_debounce_stats(&edges, &wakeups, false);
+    host_clock_get_stats(&clock, false);
+    printf("  %s: %u edges, %u wakeups, %u timer starts, longest interrupt %llu ns on the host\n", trace->path,
+           edges, wakeups, clock.starts, (unsigned long long)irq_max_ns);
+
+    for (uint32_t i = 0; i < gesture_count; ++i)
+    {
+        while (edge + 1 < trace->edge_count && trace->edge_ticks[edge + 1] <= gesture_ticks[i])
+        {
+            edge++;
+        }
+        printf("    %-10s %7.1f ms after the last edge\n", gesture_names[i],
+               (double)(gesture_ticks[i] - trace->edge_ticks[edge]) * 1000 / APP_TIMER_CLOCK_FREQ);
+
+        size_t length = strlen(result);
+        snprintf(result + length, sizeof(result) - length, "%s%s", length ? " " : "", gesture_names[i]);
+    }
+
+    check_log(trace);
+
+    latency_histogram latency;
+    latency_trace_get(LATENCY_STAGE_PWM_RELOAD, &latency);
+    CHECK(gesture_count == 0 || latency.count > 0);
+    check_latency();
+
+    if (strcmp(result, trace->expected) != 0)
+    {
+        fprintf(stderr, "%s: gestures '%s', expected '%s'\n", trace->path, result, trace->expected);
+        host_failures++;
+    }
+}
+
+int main(void)
+{
+    static test_trace trace;
+    glob_t paths;
+
+    CHECK(glob("traces/*.txt", 0, NULL, &paths) == 0);
+    for (size_t i = 0; i < paths.gl_pathc; ++i)
+    {
+        CHECK(load(paths.gl_pathv[i], &trace));
+        CHECK(host_boot(replay, &trace) == 0);
+    }
+    globfree(&paths);
+
+    return host_test_result(BUTTON_DISPATCH_FROM_IRQ ? "test_button_replay_irq" : "test_button_replay");
+}
@@ -0,0 +1,172 @@
+/**
+ * @brief Стоимость обработки фронта в button_handler.c от числа кнопок
+ *
+ * Фронт находит кнопку по таблице выводов и работает только с ее автоматом,
+ * срабатывание таймера обрабатывает только кнопки с ожидающими сроками.
+ * Вызовы button_fsm из button_handler.c считаются через --wrap компоновщика,
+ * время хоста на фронт выводится только для сравнения.
+ */
+
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include "app_error.h"
+#include "app_timer.h"
+#include "app_util.h"
+#include "button_fsm.h"
+#include "button_handler.h"
+#include "host_clock.h"
+#include "host_gpio.h"
+#include "host_test.h"
+#include "rtc_clock.h"
+
+#define TEST_CLICKS 200
+#define TEST_BOUNCES 4
+
+static uint32_t fsm_calls = 0;
+
+void __real_button_fsm_edge(button_fsm_t *fsm, uint32_t now);
+void __real_button_fsm_process(button_fsm_t *fsm, uint32_t now, bool pressed);
+button_fsm_timer_action __real_button_fsm_schedule(button_fsm_timer_t *timer, const button_fsm_t *fsm, uint32_t now,
+                                                   uint32_t min_timeout, uint32_t *timeout);
+
+void __wrap_button_fsm_edge(button_fsm_t *fsm, uint32_t now)
+{
+    fsm_calls++;
+    __real_button_fsm_edge(fsm, now);
+}
+
+void __wrap_button_fsm_process(button_fsm_t *fsm, uint32_t now, bool pressed)
+{
+    fsm_calls++;
+    __real_button_fsm_process(fsm, now, pressed);
+}
+
+button_fsm_timer_action __wrap_button_fsm_schedule(button_fsm_timer_t *timer, const button_fsm_t *fsm, uint32_t now,
+                                                   uint32_t min_timeout, uint32_t *timeout)
+{
+    fsm_calls++;
+    return __real_button_fsm_schedule(timer, fsm, now, min_timeout, timeout);
+}
+
+static void on_click(void)
+{
+}
+
+static const gesture_pattern test_gestures[] = {
+    {.presses = 1, .action = on_click},
+};
+
+static uint64_t host_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+typedef struct
+{
+    uint32_t edge_calls_max;
+    uint32_t timer_calls_max;
+} test_result;
+
+static test_result *results;
+
+static void run_until(uint64_t ticks, uint32_t *calls_max)
+{
+    uint64_t next;
+
+    while ((next = host_clock_next_timeout()) <= ticks)
+    {
+        uint32_t before = fsm_calls;
+
+        host_clock_run_until(next);
+        if (fsm_calls - before > *calls_max)
+        {
+            *calls_max = fsm_calls - before;
+        }
+        button_process();
+    }
+    host_clock_run_until(ticks);
+}
+
+/**
+ * @brief Клики с дребезгом на последней кнопке, остальные в покое
+ */
+static void clicks(void *context)
+{
+    uint8_t count = *(const uint8_t *)context;
+    button_config_t configs[BUTTON_MAX_COUNT];
+    test_result *result = &results[count - 1];
+    uint64_t edge_ns = 0;
+    uint32_t edges = 0;
+
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        configs[i] = (button_config_t){
+            .pin = NRF_GPIO_PIN_MAP(0, 2 + i), .gestures = test_gestures, .gesture_count = ARRAY_SIZE(test_gestures)};
+    }
+    rtc_clock_init();
+    button_init(configs, count);
+
+    uint32_t pin = configs[count - 1].pin;
+    for (uint32_t click = 0; click < TEST_CLICKS; ++click)
+    {
+        for (uint32_t edge = 0; edge < 2 * (2 * TEST_BOUNCES + 1); ++edge)
+        {
+            // Дребезг каждые 2 тика, нажатие и отпускание через 200 мс
+            uint64_t at = host_clock_now() + (edge == 2 * TEST_BOUNCES + 1 ? APP_TIMER_TICKS(200) : 2);
+
+            run_until(at, &result->timer_calls_max);
+
+            uint32_t before = fsm_calls;
+            uint64_t start = host_ns();
+            host_gpio_set(pin, edge % 2);
+            edge_ns += host_ns() - start;
+            edges++;
+            if (fsm_calls - before > result->edge_calls_max)
+            {
+                result->edge_calls_max = fsm_calls - before;
+            }
+            button_process();
+        }
+        run_until(host_clock_now() + APP_TIMER_TICKS(1000), &result->timer_calls_max);
+    }
+
+    printf("  %u buttons: %u button_fsm calls per edge, %u per timer expiry at most; %llu ns per edge on the host\n",
+           count, result->edge_calls_max, result->timer_calls_max, (unsigned long long)(edge_ns / edges));
+}
+
+/**
+ * @brief Две кнопки на одном выводе: ошибка драйвера не теряется
+ */
+static void pin_conflict(void *context)
+{
+    button_config_t configs[2] = {
+        {.pin = BUTTON_PIN, .gestures = test_gestures, .gesture_count = ARRAY_SIZE(test_gestures)},
+        {.pin = BUTTON_PIN, .gestures = test_gestures, .gesture_count = ARRAY_SIZE(test_gestures)},
+    };
+
+    rtc_clock_init();
+    button_init(configs, ARRAY_SIZE(configs));
+}
+
+int main(void)
+{
+    // Результаты загрузок видны родителю
+    results = mmap(NULL, BUTTON_MAX_COUNT * sizeof(*results), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                   -1, 0);
+    memset(results, 0, BUTTON_MAX_COUNT * sizeof(*results));
+
+    for (uint8_t count = 1; count <= BUTTON_MAX_COUNT; ++count)
+    {
+        CHECK(host_boot(clicks, &count) == 0);
+        CHECK(results[count - 1].edge_calls_max == results[0].edge_calls_max);
+        CHECK(results[count - 1].timer_calls_max == results[0].timer_calls_max);
+    }
+
+    CHECK(host_boot(pin_conflict, NULL) == HOST_APP_ERROR_STATUS);
+
+    return host_test_result("test_button_scaling");
+}
@@ -0,0 +1,85 @@
+/**
+ * @brief Часы эффектов effect_clock на виртуальных часах RTC
+ *
+ * Фаза считается от точки привязки по общим часам rtc_clock и не должна
+ * зависеть от того, вызывались ли часы эффектов во время переполнений
+ * 24-битного счетчика RTC. Новая серия tap-tempo не должна смешиваться с
+ * интервалами прежней, а начало доли должно совпасть с моментом последнего
+ * удара, хотя удары обрабатываются позже нажатия. Сеанс tap-tempo принимает
+ * весь диапазон темпа.
+ */
+
+#include "app_timer.h"
+#include "effect_clock.h"
+#include "host_clock.h"
+#include "host_test.h"
+#include "rtc_clock.h"
+
+#define TEST_IDLE_S 1500
+#define TEST_BPM 120
+// Задержка обработки удара после нажатия: антидребезг и основной цикл
+#define TEST_TAP_DELAY_MS 470
+
+static uint64_t tap_press = 0;
+
+/**
+ * @brief Серия ударов: каждый обрабатывается через TEST_TAP_DELAY_MS после нажатия
+ */
+static void tap_series(uint32_t taps, uint32_t interval_ms)
+{
+    for (uint32_t i = 0; i < taps; ++i)
+    {
+        tap_press = host_clock_now() - APP_TIMER_TICKS(TEST_TAP_DELAY_MS) + APP_TIMER_TICKS(interval_ms);
+        host_clock_run_until(tap_press + APP_TIMER_TICKS(TEST_TAP_DELAY_MS));
+        effect_clock_tap(tap_press);
+    }
+}
+
+int main(void)
+{
+    rtc_clock_init();
+    effect_clock_init();
+
+    // Эффект выключен: часы эффектов не вызываются, RTC переполняется
+    CHECK(effect_clock_set_bpm(TEST_BPM * 1000));
+    host_clock_run_until(APP_TIMER_TICKS(TEST_IDLE_S * 1000));
+
+    uint32_t beats = effect_clock_beats();
+    uint32_t expected = TEST_IDLE_S * TEST_BPM / 60 * EFFECT_CLOCK_BEAT_ONE;
+    printf("  after %u s without calls: %u.%04u beats, expected %u\n", TEST_IDLE_S,
+           (unsigned)(beats / EFFECT_CLOCK_BEAT_ONE), (unsigned)((beats % EFFECT_CLOCK_BEAT_ONE) * 10000 / EFFECT_CLOCK_BEAT_ONE),
+           (unsigned)(expected / EFFECT_CLOCK_BEAT_ONE));
+    CHECK(beats - expected + EFFECT_CLOCK_BEAT_ONE / 100 <= EFFECT_CLOCK_BEAT_ONE / 50);
+
+    // Серия 100 BPM (3 интервала), пауза, серия 150 BPM: среднее только по новой серии
+    tap_series(4, 600);
+    CHECK(effect_clock_get_bpm() / 1000 == 100);
+
+    // Последний удар - начало доли: через 470 мс при 100 BPM фаза 470 / 600
+    uint32_t phase = effect_clock_beats() % EFFECT_CLOCK_BEAT_ONE;
+    uint32_t expected_phase = EFFECT_CLOCK_BEAT_ONE * TEST_TAP_DELAY_MS / 600;
+    printf("  phase %u ms after the last tap: %u/65536, expected %u/65536\n", TEST_TAP_DELAY_MS,
+           (unsigned)phase, (unsigned)expected_phase);
+    CHECK((uint32_t)(phase - expected_phase + EFFECT_CLOCK_BEAT_ONE / 200) <= EFFECT_CLOCK_BEAT_ONE / 100);
+
+    host_clock_run_until(host_clock_now() + APP_TIMER_TICKS(5000));
+    tap_series(1, 0);
+    tap_series(3, 400);
+
+    uint32_t bpm = effect_clock_get_bpm();
+    printf("  tap tempo after a pause: %u.%03u BPM\n", bpm / 1000, bpm % 1000);
+    CHECK(bpm > 149900 && bpm < 150100);
+
+    // Сеанс tap-tempo: границы диапазона темпа, окончание после паузы
+    effect_clock_tap_begin();
+    tap_series(5, 200);
+    CHECK(effect_clock_tap_session());
+    CHECK(effect_clock_get_bpm() > EFFECT_CLOCK_BPM_MAX * 999);
+    effect_clock_tap_begin();
+    tap_series(5, 3000);
+    CHECK(effect_clock_get_bpm() > EFFECT_CLOCK_BPM_MIN * 999 && effect_clock_get_bpm() <= EFFECT_CLOCK_BPM_MIN * 1000);
+    host_clock_run_until(tap_press + APP_TIMER_TICKS(3100));
+    CHECK(!effect_clock_tap_session());
+
+    return host_test_result("test_effect_clock");
+}
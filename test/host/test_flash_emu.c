@@ -0,0 +1,109 @@
+/**
+ * @brief Проверка эмулятора флеш и сборки nvmc_control.c поверх него
+ */
+
+#include <string.h>
+
+#include "flash_emu.h"
+#include "host_test.h"
+#include "nvmc_control.h"
+#include "nrfx_nvmc.h"
+
+#define TEST_WORD_ADDR (FLASH_EMU_BASE + FLASH_EMU_SIZE - sizeof(uint32_t))
+
+static const uint32_t test_settings[] = {0x12345678, 0x9ABCDEF0, 0x0BADF00D};
+
+static void write_set_bits(void *context)
+{
+    nrfx_nvmc_word_write(TEST_WORD_ADDR, 0xFFFF0000);
+    nrfx_nvmc_word_write(TEST_WORD_ADDR, 0xFF00FF00);
+}
+
+static void write_three_times(void *context)
+{
+    nrfx_nvmc_word_write(TEST_WORD_ADDR, 0xFFFFFFF0);
+    nrfx_nvmc_word_write(TEST_WORD_ADDR, 0xFFFFFF00);
+    nrfx_nvmc_word_write(TEST_WORD_ADDR, 0xFFFFF000);
+}
+
+static void write_unaligned(void *context)
+{
+    nrfx_nvmc_word_write(TEST_WORD_ADDR - 2, 0);
+}
+
+static void write_torn(void *context)
+{
+    flash_emu_cut_after(0);
+    nrfx_nvmc_word_write(TEST_WORD_ADDR, 0x0000FFFF);
+}
+
+static void erase_sliced(void *context)
+{
+    uint32_t page = FLASH_EMU_BASE + FLASH_EMU_SIZE - FLASH_EMU_PAGE_SIZE;
+    flash_emu_stats stats;
+    uint32_t slices = 0;
+
+    nrfx_nvmc_word_write(page, 0);
+    flash_emu_get_stats(&stats, true);
+
+    CHECK(nrfx_nvmc_page_partial_erase_init(page + 4, 2) == NRFX_ERROR_INVALID_ADDR);
+    CHECK(nrfx_nvmc_page_partial_erase_init(page, 2) == NRFX_SUCCESS);
+    do
+    {
+        slices++;
+    } while (!nrfx_nvmc_page_partial_erase_continue());
+
+    flash_emu_get_stats(&stats, false);
+    CHECK(slices == (FLASH_EMU_ERASE_MS + 1) / 2);
+    CHECK(stats.max_block_us == 2000);
+    CHECK(stats.erases[FLASH_EMU_PAGE_COUNT - 1] == 1);
+    CHECK(*(uint32_t *)(uintptr_t)page == 0xFFFFFFFF);
+}
+
+static void nvmc_save(void *context)
+{
+    nvmc_initialize();
+    CHECK(nvmc_write_async(NVMC_KEY_SETTINGS, test_settings, sizeof(test_settings), NULL));
+    while (nvmc_process())
+    {
+    }
+}
+
+static void nvmc_restore(void *context)
+{
+    uint32_t buffer[3];
+
+    nvmc_initialize();
+    CHECK(nvmc_read(NVMC_KEY_SETTINGS, buffer, sizeof(buffer)) == sizeof(buffer));
+    CHECK(memcmp(buffer, test_settings, sizeof(buffer)) == 0);
+    CHECK(nvmc_read(NVMC_KEY_PALETTE, buffer, sizeof(buffer)) == 0);
+}
+
+int main(int argc, char **argv)
+{
+    volatile uint32_t *word = (volatile uint32_t *)(uintptr_t)TEST_WORD_ADDR;
+
+    flash_emu_open(argc > 1 ? argv[1] : "test_flash_emu.flash");
+
+    // Правила NOR: только 1 -> 0, не больше двух записей слова, выравнивание
+    flash_emu_format();
+    CHECK(host_boot(write_set_bits, NULL) == FLASH_EMU_FAULT_STATUS);
+    flash_emu_format();
+    CHECK(host_boot(write_three_times, NULL) == FLASH_EMU_FAULT_STATUS);
+    CHECK(host_boot(write_unaligned, NULL) == FLASH_EMU_FAULT_STATUS);
+
+    // Отключение питания оставляет только часть сброшенных бит
+    flash_emu_format();
+    CHECK(host_boot(write_torn, NULL) == FLASH_EMU_CUT_STATUS);
+    CHECK((*word & 0x0000FFFF) == 0x0000FFFF);
+
+    flash_emu_format();
+    CHECK(host_boot(erase_sliced, NULL) == 0);
+
+    // Значение переживает перезагрузку: образ флеш общий для процессов
+    flash_emu_format();
+    CHECK(host_boot(nvmc_save, NULL) == 0);
+    CHECK(host_boot(nvmc_restore, NULL) == 0);
+
+    return host_test_result("test_flash_emu");
+}
@@ -0,0 +1,106 @@
+/**
+ * @brief Стоимость поиска последних записей при загрузке в зависимости от
+ * заполнения журнала nvmc_control
+ *
+ * Загрузка находит конец журнала страницы двоичным поиском по каталогу и
+ * обходит только незакрытый сегмент и сегмент с последней записью ключа,
+ * CRC считается только для последней записи каждого ключа. Поэтому ни число
+ * чтений, ни расчет CRC не растут с длиной журнала. После загрузки запись
+ * работает по индексу в RAM и журнал заново не читает.
+ */
+
+#include "flash_emu.h"
+#include "host_test.h"
+#include "nvmc_control.h"
+
+// Оценка для nRF52840 на 64 МГц, как в test_nvmc_kv.c
+#define TEST_READ_CYCLES 2
+#define TEST_CRC_CYCLES_PER_BYTE 40
+
+#define TEST_WRITES_AFTER_BOOT 100
+
+// Потолок чтений при загрузке: заголовок, двоичный поиск и каталог каждой
+// страницы, обход двух сегментов по заголовку и подтверждению каждой записи
+// из пяти слов со смещением первой записи из каталога, номер, заголовок и
+// CRC последней записи
+#define TEST_SEGMENT_COUNT (NVMC_PAGE_SIZE / sizeof(uint32_t) / NVMC_SEGMENT_WORDS)
+#define TEST_SEGMENT_READS (2 * (NVMC_SEGMENT_WORDS / 5 + 1) + 1)
+#define TEST_BOOT_READS_MAX (FLASH_EMU_PAGE_COUNT * (2 + 2 * TEST_SEGMENT_COUNT) + 2 * TEST_SEGMENT_READS + 3)
+
+static const uint32_t fill_levels[] = {0, 50, 100, 200, 400, 600, 1000};
+
+static void run_until_idle(void)
+{
+    while (nvmc_process())
+    {
+    }
+}
+
+static void fill(void *context)
+{
+    uint32_t records = *(const uint32_t *)context;
+
+    nvmc_initialize();
+    for (uint32_t value = 0; value < records; ++value)
+    {
+        CHECK(nvmc_write_async(NVMC_KEY_SETTINGS, &value, sizeof(value), NULL));
+        run_until_idle();
+    }
+}
+
+static void boot(void *context)
+{
+    uint32_t records = *(const uint32_t *)context;
+    flash_emu_stats flash;
+    uint32_t value;
+
+    flash_emu_get_stats(&flash, true);
+    host_crc32_bytes = 0;
+
+    nvmc_initialize();
+
+    flash_emu_get_stats(&flash, true);
+    uint64_t boot_crc_bytes = host_crc32_bytes;
+    uint64_t cycles = flash.words_read * TEST_READ_CYCLES + boot_crc_bytes * TEST_CRC_CYCLES_PER_BYTE;
+
+    printf("  %4u records written: %5llu words read, %2llu CRC bytes, ~%3llu us\n", records,
+           (unsigned long long)flash.words_read, (unsigned long long)boot_crc_bytes,
+           (unsigned long long)(cycles / FLASH_EMU_CPU_MHZ));
+
+    // Один ключ - одна проверка CRC: заголовок, номер и одно слово данных
+    CHECK(boot_crc_bytes == (records ? 3 * sizeof(uint32_t) : 0));
+    // Чтения не зависят от числа записей в журнале
+    CHECK(flash.words_read <= TEST_BOOT_READS_MAX);
+
+    if (records > 0)
+    {
+        CHECK(nvmc_read(NVMC_KEY_SETTINGS, &value, sizeof(value)) == sizeof(value));
+        CHECK(value == records - 1);
+    }
+
+    // Записи после загрузки продолжают журнал по индексу
+    for (value = 0; value < TEST_WRITES_AFTER_BOOT; ++value)
+    {
+        CHECK(nvmc_write_async(NVMC_KEY_PALETTE, &value, sizeof(value), NULL));
+        run_until_idle();
+    }
+    flash_emu_get_stats(&flash, false);
+    CHECK(flash.words_read <= 2 * TEST_WRITES_AFTER_BOOT);
+}
+
+int main(int argc, char **argv)
+{
+    flash_emu_open(argc > 1 ? argv[1] : "test_nvmc_boot.flash");
+
+    for (uint32_t i = 0; i < sizeof(fill_levels) / sizeof(fill_levels[0]); ++i)
+    {
+        uint32_t records = fill_levels[i];
+
+        flash_emu_format();
+        CHECK(host_boot(fill, &records) == 0);
+        CHECK(host_boot(boot, &records) == 0);
+    }
+
+    printf("  ceiling: %u words read at any fill level\n", (unsigned)TEST_BOOT_READS_MAX);
+    return host_test_result("test_nvmc_boot");
+}
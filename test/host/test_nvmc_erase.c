@@ -0,0 +1,69 @@
+/**
+ * @brief Наибольшее время остановки процессора операциями nvmc_control
+ *
+ * Нагрузка со сборкой мусора стирает страницы по частям. Эмулятор считает
+ * длительность каждой операции с флеш, nvmc_get_stats() - длительность
+ * шагов nvmc_process() по DWT. Ни один шаг не должен останавливать
+ * процессор дольше одной части стирания (NVMC_ERASE_SLICE_MS) вместо
+ * полного стирания страницы.
+ */
+
+#include "flash_emu.h"
+#include "host_test.h"
+#include "nvmc_control.h"
+
+#define TEST_WRITES 3000
+
+// Длительность части стирания, как в nvmc_control.c (вариант _1ms задает 1)
+#ifndef NVMC_ERASE_SLICE_MS
+#define NVMC_ERASE_SLICE_MS 2
+#endif
+
+static void workload(void *context)
+{
+    uint32_t record[NVMC_MAX_RECORD_SIZE / sizeof(uint32_t)] = {0};
+    flash_emu_stats flash;
+    nvmc_stats stats;
+
+    nvmc_initialize();
+    nvmc_get_stats(&stats, true);
+    flash_emu_get_stats(&flash, true);
+
+    for (uint32_t n = 0; n < TEST_WRITES; ++n)
+    {
+        // Чередование коротких и длинных записей, как настройки и палитра
+        bool large = n % 2;
+
+        record[0] = n;
+        CHECK(nvmc_write_async(large ? NVMC_KEY_PALETTE : NVMC_KEY_SETTINGS, record,
+                               large ? 16 * sizeof(uint32_t) : 3 * sizeof(uint32_t), NULL));
+        while (nvmc_process())
+        {
+        }
+    }
+
+    nvmc_get_stats(&stats, false);
+    flash_emu_get_stats(&flash, false);
+
+    uint32_t erases = 0;
+    for (uint32_t page = 0; page < FLASH_EMU_PAGE_COUNT; ++page)
+    {
+        erases += flash.erases[page];
+    }
+
+    printf("  %u ms slices: longest step %u us, erase slice %u us, word write %u us; "
+           "%u erases in %u slices (blocking erase: %u us)\n",
+           NVMC_ERASE_SLICE_MS, stats.max_step_us, stats.max_erase_us, stats.max_write_us, erases,
+           stats.erase_slices, FLASH_EMU_ERASE_MS * 1000);
+
+    CHECK(erases > 0);
+    CHECK(flash.max_block_us <= NVMC_ERASE_SLICE_MS * 1000);
+    CHECK(stats.max_step_us <= NVMC_ERASE_SLICE_MS * 1000 + FLASH_EMU_WRITE_US);
+}
+
+int main(int argc, char **argv)
+{
+    flash_emu_open(argc > 1 ? argv[1] : "test_nvmc_erase.flash");
+    CHECK(host_boot(workload, NULL) == 0);
+    return host_test_result(NVMC_ERASE_SLICE_MS == 2 ? "test_nvmc_erase" : "test_nvmc_erase_1ms");
+}
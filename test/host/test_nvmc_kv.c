@@ -0,0 +1,246 @@
+/**
+ * @brief Хранилище ключ-значение nvmc_control: задержки чтения и записи,
+ * паузы сборки мусора и стоимость загрузки
+ *
+ * Время операций с флеш считает эмулятор (такты DWT), чтения флеш и байты
+ * CRC считаются на хосте и переводятся в такты по оценкам ниже.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "flash_emu.h"
+#include "host_test.h"
+#include "nvmc_control.h"
+
+#define TEST_WRITES 3000
+#define TEST_SMALL_RECORDS 500
+#define TEST_OLDER_VALUE 0x0DDC0FFE
+#define TEST_NEWER_VALUE 0xC0FFEE01
+
+// Оценка для nRF52840 на 64 МГц: чтение слова флеш через кэш и побитовый
+// crc32_compute() из SDK
+#define TEST_READ_CYCLES 2
+#define TEST_CRC_CYCLES_PER_BYTE 40
+
+// Потолок чтений при загрузке: заголовок, двоичный поиск и каталог каждой
+// страницы; обход незакрытого сегмента и не больше одного сегмента на ключ
+// по заголовку и подтверждению записей не короче пяти слов; номер, заголовок
+// и CRC последней записи каждого ключа. Зависит от числа ключей, но не от
+// длины журнала
+#define TEST_SEGMENT_COUNT (NVMC_PAGE_SIZE / sizeof(uint32_t) / NVMC_SEGMENT_WORDS)
+#define TEST_SEGMENT_READS (2 * (NVMC_SEGMENT_WORDS / 5 + 1) + 1)
+#define TEST_BOOT_READS_MAX                                                                               \
+    (FLASH_EMU_PAGE_COUNT * (2 + 2 * TEST_SEGMENT_COUNT) + (NVMC_MAX_KEYS + 1) * TEST_SEGMENT_READS + \
+     3 * NVMC_MAX_KEYS)
+
+// Записи другого ключа между двумя записями ключа: больше сегмента
+#define TEST_FILLER_RECORDS (NVMC_SEGMENT_WORDS / 5 + 1)
+
+static uint32_t expected[NVMC_MAX_KEYS][NVMC_MAX_RECORD_SIZE / sizeof(uint32_t)];
+static uint32_t expected_words[NVMC_MAX_KEYS];
+
+/**
+ * @brief Следующая случайная запись, ожидаемое значение ключа обновляется
+ */
+static nvmc_key next_record(uint32_t *words)
+{
+    nvmc_key key = rand() % NVMC_MAX_KEYS;
+
+    *words = 1 + rand() % (NVMC_MAX_RECORD_SIZE / sizeof(uint32_t));
+    for (uint32_t i = 0; i < *words; ++i)
+    {
+        expected[key][i] = rand();
+    }
+    expected_words[key] = *words;
+    return key;
+}
+
+static void run_until_idle(uint32_t *steps)
+{
+    while (nvmc_process())
+    {
+        (*steps)++;
+    }
+}
+
+/**
+ * @brief Случайные записи всех ключей с проверкой чтения после каждой
+ */
+static void workload(void *context)
+{
+    uint32_t max_steps = 0;
+    uint64_t total_steps = 0;
+    uint32_t max_read_words = 0;
+    flash_emu_stats flash;
+    nvmc_stats stats;
+
+    srand(1);
+    nvmc_initialize();
+    nvmc_get_stats(&stats, true);
+    flash_emu_get_stats(&flash, true);
+
+    for (uint32_t n = 0; n < TEST_WRITES; ++n)
+    {
+        uint32_t words;
+        nvmc_key key = next_record(&words);
+        uint32_t buffer[NVMC_MAX_RECORD_SIZE / sizeof(uint32_t)];
+        uint32_t steps = 0;
+
+        CHECK(nvmc_write_async(key, expected[key], words * sizeof(uint32_t), NULL));
+        run_until_idle(&steps);
+        total_steps += steps;
+        if (steps > max_steps)
+        {
+            max_steps = steps;
+        }
+
+        flash_emu_get_stats(&flash, false);
+        uint64_t reads_before = flash.words_read;
+
+        CHECK(nvmc_read(key, buffer, words * sizeof(uint32_t)) == words * sizeof(uint32_t));
+        CHECK(memcmp(buffer, expected[key], words * sizeof(uint32_t)) == 0);
+
+        flash_emu_get_stats(&flash, false);
+        if (flash.words_read - reads_before > max_read_words)
+        {
+            max_read_words = flash.words_read - reads_before;
+        }
+    }
+
+    nvmc_get_stats(&stats, false);
+    flash_emu_get_stats(&flash, false);
+
+    uint32_t erases = 0;
+    for (uint32_t page = 0; page < FLASH_EMU_PAGE_COUNT; ++page)
+    {
+        erases += flash.erases[page];
+    }
+
+    printf("  %u writes of 1..%u words: %llu steps on average, %u at most (with GC)\n", TEST_WRITES,
+           (unsigned)(NVMC_MAX_RECORD_SIZE / sizeof(uint32_t)), (unsigned long long)(total_steps / TEST_WRITES),
+           max_steps);
+    printf("  read: %u flash words at most (header + data)\n", max_read_words);
+    printf("  longest step %u us (word write %u us, erase slice %u us), %u page erases\n", stats.max_step_us,
+           stats.max_write_us, stats.max_erase_us, erases);
+}
+
+static void boot(void *context)
+{
+    flash_emu_stats flash;
+    uint32_t buffer[NVMC_MAX_RECORD_SIZE / sizeof(uint32_t)];
+
+    flash_emu_get_stats(&flash, true);
+    host_crc32_bytes = 0;
+
+    nvmc_initialize();
+
+    flash_emu_get_stats(&flash, false);
+    uint64_t cycles = flash.words_read * TEST_READ_CYCLES + host_crc32_bytes * TEST_CRC_CYCLES_PER_BYTE;
+    printf("  boot: %llu flash words read, %llu bytes CRC-checked, ~%llu us\n",
+           (unsigned long long)flash.words_read, (unsigned long long)host_crc32_bytes,
+           (unsigned long long)(cycles / FLASH_EMU_CPU_MHZ));
+    CHECK(flash.words_read <= TEST_BOOT_READS_MAX);
+
+    for (nvmc_key key = 0; key < NVMC_MAX_KEYS; ++key)
+    {
+        uint32_t size = expected_words[key] * sizeof(uint32_t);
+        CHECK(nvmc_read(key, buffer, size) == size);
+        CHECK(memcmp(buffer, expected[key], size) == 0);
+    }
+}
+
+/**
+ * @brief Журнал из коротких записей: наибольшее число записей на загрузку
+ */
+static void fill_small(void *context)
+{
+    uint32_t steps = 0;
+
+    nvmc_initialize();
+    for (uint32_t value = 0; value < TEST_SMALL_RECORDS; ++value)
+    {
+        CHECK(nvmc_write_async(NVMC_KEY_SETTINGS, &value, sizeof(value), NULL));
+        run_until_idle(&steps);
+    }
+}
+
+/**
+ * @brief Две записи ключа, затем бит данных последней теряется при хранении
+ *
+ * Между записями пишется заданное число записей другого ключа, чтобы
+ * предыдущая запись оказалась в более старом сегменте.
+ */
+static void damage_newest(void *context)
+{
+    uint32_t fillers = *(const uint32_t *)context;
+    uint32_t older[2] = {TEST_OLDER_VALUE, TEST_OLDER_VALUE};
+    uint32_t newer[2] = {TEST_NEWER_VALUE, TEST_NEWER_VALUE};
+    uint32_t steps = 0;
+
+    nvmc_initialize();
+    CHECK(nvmc_write_async(NVMC_KEY_PALETTE, older, sizeof(older), NULL));
+    run_until_idle(&steps);
+    for (uint32_t value = 0; value < fillers; ++value)
+    {
+        CHECK(nvmc_write_async(NVMC_KEY_SETTINGS, &value, sizeof(value), NULL));
+        run_until_idle(&steps);
+    }
+    CHECK(nvmc_write_async(NVMC_KEY_PALETTE, newer, sizeof(newer), NULL));
+    run_until_idle(&steps);
+
+    for (uint32_t *word = (uint32_t *)(uintptr_t)FLASH_EMU_BASE;
+         word < (uint32_t *)(uintptr_t)(FLASH_EMU_BASE + FLASH_EMU_SIZE); ++word)
+    {
+        if (*word == TEST_NEWER_VALUE)
+        {
+            *word &= ~1UL;
+            break;
+        }
+    }
+}
+
+static void check_fallback(void *context)
+{
+    uint32_t buffer[2];
+
+    nvmc_initialize();
+    CHECK(nvmc_read(NVMC_KEY_PALETTE, buffer, sizeof(buffer)) == sizeof(buffer));
+    CHECK(buffer[0] == TEST_OLDER_VALUE && buffer[1] == TEST_OLDER_VALUE);
+}
+
+int main(int argc, char **argv)
+{
+    flash_emu_open(argc > 1 ? argv[1] : "test_nvmc_kv.flash");
+
+    CHECK(host_boot(workload, NULL) == 0);
+
+    // Нагрузка шла в дочернем процессе - ожидаемые значения повторяются здесь
+    srand(1);
+    for (uint32_t n = 0, words; n < TEST_WRITES; ++n)
+    {
+        next_record(&words);
+    }
+    CHECK(host_boot(boot, NULL) == 0);
+
+    flash_emu_format();
+    CHECK(host_boot(fill_small, NULL) == 0);
+    memset(expected_words, 0, sizeof(expected_words));
+    expected[NVMC_KEY_SETTINGS][0] = TEST_SMALL_RECORDS - 1;
+    expected_words[NVMC_KEY_SETTINGS] = 1;
+    CHECK(host_boot(boot, NULL) == 0);
+
+    // Поврежденная последняя запись: загрузка берет предыдущую из того же
+    // сегмента или из более старого по каталогу
+    uint32_t fillers = 0;
+    flash_emu_format();
+    CHECK(host_boot(damage_newest, &fillers) == 0);
+    CHECK(host_boot(check_fallback, NULL) == 0);
+
+    fillers = TEST_FILLER_RECORDS;
+    flash_emu_format();
+    CHECK(host_boot(damage_newest, &fillers) == 0);
+    CHECK(host_boot(check_fallback, NULL) == 0);
+
+    return host_test_result("test_nvmc_kv");
+}
@@ -0,0 +1,183 @@
+/**
+ * @brief Упакованные значения nvmc_control: отключение питания и износ
+ *
+ * Упакованные и обычные записи чередуются, питание отключается на каждой
+ * операции с флеш по очереди. После перезагрузки каждый ключ должен читать
+ * значение не старше последнего подтвержденного и не новее поставленного в
+ * очередь. Недописанный заголовок обычной записи не должен читаться как
+ * упакованное слово.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "flash_emu.h"
+#include "host_test.h"
+#include "nvmc_control.h"
+
+#define TEST_ROUNDS 240
+#define TEST_RECORD_WORDS 8
+#define TEST_WEAR_ERASES 30
+
+// Прогресс записи виден родителю после отключения питания в дочернем процессе
+typedef struct
+{
+    uint32_t issued;
+    uint32_t packed_done;
+    uint32_t record_done;
+} test_progress;
+
+static test_progress *progress;
+
+static void packed_done(nvmc_packed_key key)
+{
+    uint32_t value;
+    if (nvmc_read_packed(key, &value))
+    {
+        progress->packed_done = value;
+    }
+}
+
+static void record_done(nvmc_key key)
+{
+    uint32_t record[TEST_RECORD_WORDS];
+    if (nvmc_read(key, record, sizeof(record)))
+    {
+        progress->record_done = record[0];
+    }
+}
+
+static void run_until_idle(void)
+{
+    while (nvmc_process())
+    {
+    }
+}
+
+static void workload(void *context)
+{
+    int64_t cut = *(const int64_t *)context;
+
+    nvmc_initialize();
+    flash_emu_cut_after(cut);
+
+    for (uint32_t round = progress->issued + 1; round <= TEST_ROUNDS; ++round)
+    {
+        uint32_t record[TEST_RECORD_WORDS];
+
+        for (uint32_t i = 0; i < TEST_RECORD_WORDS; ++i)
+        {
+            record[i] = round;
+        }
+
+        progress->issued = round;
+        CHECK(nvmc_write_packed_async(NVMC_PACKED_KEY_COLOR, round, packed_done));
+        CHECK(nvmc_write_async(NVMC_KEY_PALETTE, record, sizeof(record), record_done));
+        run_until_idle();
+    }
+}
+
+static void verify(void *context)
+{
+    uint32_t value = 0;
+    uint32_t record[TEST_RECORD_WORDS];
+
+    nvmc_initialize();
+
+    bool has_value = nvmc_read_packed(NVMC_PACKED_KEY_COLOR, &value);
+    CHECK(has_value || progress->packed_done == 0);
+    CHECK(!has_value || (value >= progress->packed_done && value <= progress->issued));
+
+    if (nvmc_read(NVMC_KEY_PALETTE, record, sizeof(record)))
+    {
+        for (uint32_t i = 1; i < TEST_RECORD_WORDS; ++i)
+        {
+            CHECK(record[i] == record[0]);
+        }
+        CHECK(record[0] >= progress->record_done && record[0] <= progress->issued);
+    }
+    else
+    {
+        CHECK(progress->record_done == 0);
+    }
+
+    // Обычные и упакованные ключи с одинаковым номером не пересекаются
+    CHECK(!nvmc_read(NVMC_KEY_SETTINGS, record, sizeof(uint32_t)));
+
+    // Журнал продолжается после сбоя: новое значение читается
+    CHECK(nvmc_write_packed_async(NVMC_PACKED_KEY_COLOR, NVMC_PACKED_VALUE_MAX, NULL));
+    run_until_idle();
+    CHECK(nvmc_read_packed(NVMC_PACKED_KEY_COLOR, &value) && value == NVMC_PACKED_VALUE_MAX);
+}
+
+/**
+ * @brief Число сохранений цвета до заданного числа стираний
+ */
+static void wear(void *context)
+{
+    bool packed = *(const bool *)context;
+    flash_emu_stats stats;
+    uint32_t saves = 0;
+    uint32_t erases = 0;
+
+    nvmc_initialize();
+    flash_emu_get_stats(&stats, true);
+
+    while (erases < TEST_WEAR_ERASES)
+    {
+        uint32_t color = saves & NVMC_PACKED_VALUE_MAX;
+
+        if (packed)
+        {
+            CHECK(nvmc_write_packed_async(NVMC_PACKED_KEY_COLOR, color, NULL));
+        }
+        else
+        {
+            CHECK(nvmc_write_async(NVMC_KEY_SETTINGS, &color, sizeof(color), NULL));
+        }
+        run_until_idle();
+        saves++;
+
+        flash_emu_get_stats(&stats, false);
+        erases = 0;
+        for (uint32_t page = 0; page < FLASH_EMU_PAGE_COUNT; ++page)
+        {
+            erases += stats.erases[page];
+        }
+    }
+
+    printf("  %s color: %u saves per page erase\n", packed ? "packed" : "record", saves / erases);
+}
+
+int main(int argc, char **argv)
+{
+    int64_t cut = 0;
+    int status;
+
+    flash_emu_open(argc > 1 ? argv[1] : "test_nvmc_packed.flash");
+    progress = mmap(NULL, sizeof(*progress), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    // Отключение питания на каждой операции, пока нагрузка не пройдет целиком
+    do
+    {
+        flash_emu_format();
+        memset(progress, 0, sizeof(*progress));
+        srand((unsigned)cut);
+
+        status = host_boot(workload, &cut);
+        CHECK(status == 0 || status == FLASH_EMU_CUT_STATUS);
+        CHECK(host_boot(verify, NULL) == 0);
+    } while (status == FLASH_EMU_CUT_STATUS && host_failures == 0 && ++cut);
+
+    printf("  power cut at %lld operations, all recovered\n", (long long)cut);
+
+    bool packed = false;
+    flash_emu_format();
+    CHECK(host_boot(wear, &packed) == 0);
+    packed = true;
+    flash_emu_format();
+    CHECK(host_boot(wear, &packed) == 0);
+
+    return host_test_result("test_nvmc_packed");
+}
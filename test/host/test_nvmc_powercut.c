@@ -0,0 +1,162 @@
+/**
+ * @brief Отключение питания на каждой операции с флеш в nvmc_control
+ *
+ * Несколько ключей разного размера пишутся по кругу, нагрузка включает
+ * смену страниц и сборку мусора. Для каждого номера операции нагрузка
+ * начинается заново на чистой флеш и обрывается на этой операции, затем
+ * загрузка проверяет, что каждый ключ читает целое значение не старше
+ * последнего подтвержденного и не новее поставленного в очередь, а число
+ * прочитанных при загрузке слов не выходит за потолок, не зависящий от
+ * места обрыва и заполнения журнала.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "flash_emu.h"
+#include "host_test.h"
+#include "nvmc_control.h"
+
+#define TEST_ROUNDS 300
+#define TEST_KEYS 3
+
+static const nvmc_key test_keys[TEST_KEYS] = {NVMC_KEY_SETTINGS, NVMC_KEY_PALETTE, NVMC_KEY_PRESETS};
+static const uint32_t test_words[TEST_KEYS] = {3, 8, 16};
+
+// Потолок чтений при загрузке: заголовок, двоичный поиск и каталог каждой
+// страницы; обход незакрытого сегмента, сегмента каждого ключа и еще одного
+// из-за лишнего ключа в маске недописанного слова каталога - по заголовку и
+// подтверждению записей не короче семи слов; номер, заголовок и CRC
+// последней записи каждого ключа
+#define TEST_SEGMENT_COUNT (NVMC_PAGE_SIZE / sizeof(uint32_t) / NVMC_SEGMENT_WORDS)
+#define TEST_SEGMENT_READS (2 * (NVMC_SEGMENT_WORDS / 7 + 1) + 1)
+#define TEST_BOOT_READS_MAX \
+    (FLASH_EMU_PAGE_COUNT * (2 + 2 * TEST_SEGMENT_COUNT) + (TEST_KEYS + 2) * TEST_SEGMENT_READS + 3 * TEST_KEYS)
+
+// Прогресс записи виден родителю после отключения питания в дочернем процессе
+typedef struct
+{
+    uint32_t issued[TEST_KEYS];
+    uint32_t done[TEST_KEYS];
+    uint64_t boot_reads;
+} test_progress;
+
+static test_progress *progress;
+
+static void record_done(nvmc_key key)
+{
+    uint32_t record[NVMC_MAX_RECORD_SIZE / sizeof(uint32_t)];
+
+    for (uint32_t i = 0; i < TEST_KEYS; ++i)
+    {
+        if (test_keys[i] == key && nvmc_read(key, record, test_words[i] * sizeof(uint32_t)))
+        {
+            progress->done[i] = record[0];
+        }
+    }
+}
+
+static void workload(void *context)
+{
+    int64_t cut = *(const int64_t *)context;
+    uint32_t record[NVMC_MAX_RECORD_SIZE / sizeof(uint32_t)];
+
+    nvmc_initialize();
+    flash_emu_cut_after(cut);
+
+    for (uint32_t round = 1; round <= TEST_ROUNDS; ++round)
+    {
+        uint32_t i = round % TEST_KEYS;
+
+        for (uint32_t word = 0; word < test_words[i]; ++word)
+        {
+            record[word] = round;
+        }
+
+        progress->issued[i] = round;
+        CHECK(nvmc_write_async(test_keys[i], record, test_words[i] * sizeof(uint32_t), record_done));
+        while (nvmc_process())
+        {
+        }
+    }
+}
+
+static void verify(void *context)
+{
+    uint32_t record[NVMC_MAX_RECORD_SIZE / sizeof(uint32_t)];
+    flash_emu_stats stats;
+
+    // Счетчики не сбрасываются: по ним main() считает стирания нагрузки
+    flash_emu_get_stats(&stats, false);
+    uint64_t reads_before = stats.words_read;
+    nvmc_initialize();
+    flash_emu_get_stats(&stats, false);
+    progress->boot_reads = stats.words_read - reads_before;
+    CHECK(progress->boot_reads <= TEST_BOOT_READS_MAX);
+
+    for (uint32_t i = 0; i < TEST_KEYS; ++i)
+    {
+        if (nvmc_read(test_keys[i], record, test_words[i] * sizeof(uint32_t)) == 0)
+        {
+            CHECK(progress->done[i] == 0);
+            continue;
+        }
+
+        for (uint32_t word = 1; word < test_words[i]; ++word)
+        {
+            CHECK(record[word] == record[0]);
+        }
+        CHECK(record[0] >= progress->done[i] && record[0] <= progress->issued[i]);
+    }
+
+    // Журнал после сбоя принимает новые записи
+    record[0] = UINT32_MAX;
+    CHECK(nvmc_write_async(NVMC_KEY_SETTINGS, record, sizeof(uint32_t), NULL));
+    while (nvmc_process())
+    {
+    }
+    CHECK(nvmc_read(NVMC_KEY_SETTINGS, record, sizeof(uint32_t)) == sizeof(uint32_t) && record[0] == UINT32_MAX);
+}
+
+int main(int argc, char **argv)
+{
+    int64_t cut = 0;
+    int status;
+    flash_emu_stats stats;
+    uint64_t max_boot_reads = 0;
+
+    flash_emu_open(argc > 1 ? argv[1] : "test_nvmc_powercut.flash");
+    progress = mmap(NULL, sizeof(*progress), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    do
+    {
+        flash_emu_format();
+        flash_emu_get_stats(&stats, true);
+        memset(progress, 0, sizeof(*progress));
+        srand((unsigned)cut);
+
+        status = host_boot(workload, &cut);
+        CHECK(status == 0 || status == FLASH_EMU_CUT_STATUS);
+        CHECK(host_boot(verify, NULL) == 0);
+        if (progress->boot_reads > max_boot_reads)
+        {
+            max_boot_reads = progress->boot_reads;
+        }
+    } while (status == FLASH_EMU_CUT_STATUS && host_failures == 0 && ++cut);
+
+    // Счетчики последнего прохода: нагрузка без обрыва
+    flash_emu_get_stats(&stats, false);
+    uint32_t erases = 0;
+    for (uint32_t page = 0; page < FLASH_EMU_PAGE_COUNT; ++page)
+    {
+        erases += stats.erases[page];
+    }
+    printf("  power cut at each of %lld operations (%u page erases in the full run), all recovered\n",
+           (long long)cut, erases);
+    printf("  boot after a cut: %llu words read at most, ceiling %u\n", (unsigned long long)max_boot_reads,
+           (unsigned)TEST_BOOT_READS_MAX);
+    CHECK(erases > 0);
+
+    return host_test_result("test_nvmc_powercut");
+}
@@ -0,0 +1,103 @@
+/**
+ * @brief Распределение износа nvmc_control по страницам области данных
+ *
+ * Одно и то же значение настроек сохраняется много раз, эмулятор считает
+ * стирания каждой страницы. Журнал вращается по всем страницам, поэтому
+ * стирания должны распределяться равномерно, а число сохранений на одно
+ * стирание - расти с числом страниц. Сохранения идут в нескольких
+ * загрузках подряд: после перезагрузки вращение продолжается с того же места.
+ *
+ * Сохранение выполняется по шагам nvmc_process() из основного цикла, их
+ * число на одно сохранение ограничено записью, переносом живой записи при
+ * сборке мусора и стиранием одной страницы по частям.
+ */
+
+#include <sys/mman.h>
+
+#include "flash_emu.h"
+#include "host_test.h"
+#include "nvmc_control.h"
+
+#define TEST_BOOTS 10
+#define TEST_SAVES_PER_BOOT 3000
+#define TEST_SAVES (TEST_BOOTS * TEST_SAVES_PER_BOOT)
+#define TEST_SETTINGS_WORDS 3
+// Запись - заголовок, номер, данные, CRC и подтверждение
+#define TEST_ENTRY_WORDS (TEST_SETTINGS_WORDS + 4)
+// Заголовок страницы, запись и ее перенос, стирание частями не короче 1 мс и запас
+#define TEST_SAVE_STEPS_MAX (2 + 2 * TEST_ENTRY_WORDS + FLASH_EMU_ERASE_MS + 8)
+
+static uint32_t *max_steps;
+
+static void workload(void *context)
+{
+    uint32_t boot = *(const uint32_t *)context;
+    uint32_t settings[TEST_SETTINGS_WORDS] = {0};
+
+    nvmc_initialize();
+    if (boot > 0)
+    {
+        CHECK(nvmc_read(NVMC_KEY_SETTINGS, settings, sizeof(settings)) == sizeof(settings));
+        CHECK(settings[0] == boot * TEST_SAVES_PER_BOOT - 1);
+    }
+
+    for (uint32_t save = 0; save < TEST_SAVES_PER_BOOT; ++save)
+    {
+        settings[0] = boot * TEST_SAVES_PER_BOOT + save;
+        CHECK(nvmc_write_async(NVMC_KEY_SETTINGS, settings, sizeof(settings), NULL));
+
+        uint32_t steps = 0;
+        while (nvmc_process())
+        {
+            steps++;
+        }
+        if (steps > *max_steps)
+        {
+            *max_steps = steps;
+        }
+    }
+}
+
+static void report(void)
+{
+    flash_emu_stats stats;
+    uint32_t min_erases = UINT32_MAX;
+    uint32_t max_erases = 0;
+    uint32_t total = 0;
+
+    flash_emu_get_stats(&stats, false);
+    printf("  %u saves of %u words, erases per page:", TEST_SAVES, TEST_SETTINGS_WORDS);
+    for (uint32_t page = 0; page < FLASH_EMU_PAGE_COUNT; ++page)
+    {
+        printf(" %u", stats.erases[page]);
+        total += stats.erases[page];
+        if (stats.erases[page] < min_erases)
+        {
+            min_erases = stats.erases[page];
+        }
+        if (stats.erases[page] > max_erases)
+        {
+            max_erases = stats.erases[page];
+        }
+    }
+    printf(", %u saves per erase, at most %u nvmc_process() steps per save\n", TEST_SAVES / total, *max_steps);
+
+    CHECK(max_erases - min_erases <= 1);
+    // Без вращения все стирания пришлись бы на одну страницу
+    CHECK(max_erases < total);
+    CHECK(*max_steps <= TEST_SAVE_STEPS_MAX);
+}
+
+int main(int argc, char **argv)
+{
+    flash_emu_open(argc > 1 ? argv[1] : "test_nvmc_wear.flash");
+    // Результаты загрузок видны родителю
+    max_steps = mmap(NULL, sizeof(*max_steps), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    *max_steps = 0;
+    for (uint32_t boot = 0; boot < TEST_BOOTS; ++boot)
+    {
+        CHECK(host_boot(workload, &boot) == 0);
+    }
+    report();
+    return host_test_result("test_nvmc_wear");
+}
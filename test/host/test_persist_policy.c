@@ -0,0 +1,132 @@
+/**
+ * @brief Политика отложенного сохранения persist_policy на виртуальных часах
+ *
+ * Основной цикл моделируется так же, как в main.c: после каждого прерывания
+ * (изменение настроек, таймер политики или кадр ШИМ) вызывается
+ * persist_process().
+ * Сценарий: удержание кнопки в режиме оттенка, серия команд CLI и долгие
+ * непрерывные изменения.
+ */
+
+#include "app_timer.h"
+#include "host_clock.h"
+#include "host_test.h"
+#include "persist_policy.h"
+
+#define TEST_HOLD_MS 5000
+#define TEST_HOLD_REPEAT_MS 30 // LONG_PRESS_REPEAT_INTERVAL в button_handler.c
+#define TEST_CLI_COMMANDS 20
+#define TEST_CLI_INTERVAL_MS 300
+#define TEST_STREAM_MS 70000
+#define TEST_STREAM_INTERVAL_MS 100
+#define TEST_IDLE_MS 10000
+#define TEST_FRAME_MS 30 // PWM_FRAME_INTERVAL_MS: таймер кадра будит основной цикл
+
+APP_TIMER_DEF(timer_frame);
+
+static uint64_t first_unsaved = UINT64_MAX;
+static uint64_t last_mark = 0;
+static uint32_t max_flush_delay = 0;
+static persist_result next_result = PERSIST_WRITTEN;
+
+static persist_result flush(void)
+{
+    uint64_t now = host_clock_now();
+    persist_result result = next_result;
+
+    // Запись не раньше периода тишины (кроме вынужденной) и не позже предельной задержки
+    CHECK(now - first_unsaved <= APP_TIMER_TICKS(PERSIST_MAX_DELAY_MS_DEFAULT));
+    CHECK(now - last_mark >= APP_TIMER_TICKS(PERSIST_QUIET_MS_DEFAULT) ||
+          now - first_unsaved >= APP_TIMER_TICKS(PERSIST_MAX_DELAY_MS_DEFAULT));
+
+    if (now - first_unsaved > max_flush_delay)
+    {
+        max_flush_delay = now - first_unsaved;
+    }
+
+    next_result = PERSIST_WRITTEN;
+    if (result != PERSIST_RETRY)
+    {
+        first_unsaved = UINT64_MAX;
+    }
+    return result;
+}
+
+static void frame_handler(void *context)
+{
+}
+
+/**
+ * @brief Основной цикл до момента ticks: persist_process() после каждого таймера
+ */
+static void run_until(uint64_t ticks)
+{
+    uint64_t next;
+
+    while ((next = host_clock_next_timeout()) <= ticks)
+    {
+        host_clock_run_until(next);
+        persist_process();
+    }
+    host_clock_run_until(ticks);
+}
+
+static void changes(uint32_t count, uint32_t interval_ms)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        run_until(host_clock_now() + APP_TIMER_TICKS(interval_ms));
+
+        if (first_unsaved == UINT64_MAX)
+        {
+            first_unsaved = host_clock_now();
+        }
+        last_mark = host_clock_now();
+        persist_mark_dirty();
+        persist_process();
+    }
+}
+
+int main(void)
+{
+    persist_stats_t stats;
+    host_clock_stats clock;
+
+    persist_init(flush);
+    app_timer_create(&timer_frame, APP_TIMER_MODE_REPEATED, frame_handler);
+    app_timer_start(timer_frame, APP_TIMER_TICKS(TEST_FRAME_MS), NULL);
+    host_clock_get_stats(&clock, true);
+
+    changes(TEST_HOLD_MS / TEST_HOLD_REPEAT_MS, TEST_HOLD_REPEAT_MS);
+    run_until(host_clock_now() + APP_TIMER_TICKS(TEST_IDLE_MS));
+    changes(TEST_CLI_COMMANDS, TEST_CLI_INTERVAL_MS);
+    run_until(host_clock_now() + APP_TIMER_TICKS(TEST_IDLE_MS));
+    changes(TEST_STREAM_MS / TEST_STREAM_INTERVAL_MS, TEST_STREAM_INTERVAL_MS);
+    run_until(host_clock_now() + APP_TIMER_TICKS(TEST_IDLE_MS));
+
+    persist_get_stats(&stats, true);
+    host_clock_get_stats(&clock, true);
+    printf("  %u marks, %u flash writes (%u forced by the max delay), %u policy timer starts, "
+           "longest delay %u ms\n",
+           stats.marks, stats.writes, stats.forced, clock.starts,
+           (unsigned)((uint64_t)max_flush_delay * 1000 / APP_TIMER_CLOCK_FREQ));
+
+    CHECK(first_unsaved == UINT64_MAX);
+    CHECK(stats.writes == 5 && stats.forced == 2);
+
+    // Полная очередь флеш: повтор после периода тишины, срок первого изменения сохраняется
+    next_result = PERSIST_RETRY;
+    changes(1, TEST_CLI_INTERVAL_MS);
+    run_until(host_clock_now() + APP_TIMER_TICKS(TEST_IDLE_MS));
+    persist_get_stats(&stats, true);
+    CHECK(stats.writes == 1 && first_unsaved == UINT64_MAX);
+
+    // Значение вернулось к сохраненному: сброс без записи
+    next_result = PERSIST_UNCHANGED;
+    changes(1, TEST_CLI_INTERVAL_MS);
+    run_until(host_clock_now() + APP_TIMER_TICKS(TEST_IDLE_MS));
+    persist_get_stats(&stats, true);
+    CHECK(stats.writes == 0 && stats.unchanged == 1);
+
+    return host_test_result("test_persist_policy");
+}
@@ -0,0 +1,153 @@
+/**
+ * @brief Банк пресетов preset_bank поверх nvmc_control и эмулятора флеш
+ *
+ * Пресеты сохраняются много раз по кругу, после перезагрузки каждый должен
+ * вернуть последний сохраненный цвет и имя. Вызов пресета не читает флеш.
+ * Функции цвета led_control заменены простыми: банк хранит то, что вернул
+ * led_hsb_pack().
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "flash_emu.h"
+#include "host_test.h"
+#include "led_control.h"
+#include "nvmc_control.h"
+#include "preset_bank.h"
+
+#define TEST_SAVES 800
+
+static HSB_color current;
+
+void led_set_hsv_color(uint32_t hue, uint32_t saturation, uint32_t value)
+{
+    current = (HSB_color){.hue = hue, .saturation = saturation, .brightness = value};
+}
+
+HSB_color led_get_hsv_color(void)
+{
+    return current;
+}
+
+uint32_t led_hsb_pack(const HSB_color *color)
+{
+    return (color->hue << 14) | (color->saturation << 7) | color->brightness;
+}
+
+bool led_hsb_unpack(uint32_t packed, HSB_color *color)
+{
+    if (packed >> 23)
+    {
+        return false;
+    }
+    *color = (HSB_color){.hue = packed >> 14, .saturation = (packed >> 7) & 0x7F, .brightness = packed & 0x7F};
+    return true;
+}
+
+/**
+ * @brief Цвет и имя n-го сохранения
+ */
+static HSB_color save_color(uint32_t n)
+{
+    return (HSB_color){.hue = n % 360, .saturation = n % 101, .brightness = (n / 7) % 101};
+}
+
+static void save_name(uint32_t n, char *name)
+{
+    snprintf(name, PRESET_NAME_SIZE, "p%u", n);
+}
+
+static void run_until_idle(void)
+{
+    while (nvmc_process())
+    {
+    }
+}
+
+static void save_all(void *context)
+{
+    flash_emu_stats flash;
+    uint32_t retries = 0;
+
+    nvmc_initialize();
+    preset_init();
+    flash_emu_get_stats(&flash, true);
+
+    for (uint32_t n = 0; n < TEST_SAVES; ++n)
+    {
+        char name[PRESET_NAME_SIZE];
+
+        current = save_color(n);
+        save_name(n, name);
+
+        // Очередь записи заполнена: банк откатывает копию в RAM, сохранение повторяется
+        while (!preset_save(n % PRESET_COUNT, name))
+        {
+            retries++;
+            run_until_idle();
+        }
+
+        // Сохранения копятся в очереди дольше, чем она вмещает
+        if (n % 8 == 7)
+        {
+            run_until_idle();
+        }
+    }
+    run_until_idle();
+
+    flash_emu_get_stats(&flash, false);
+    uint32_t erases = 0;
+    for (uint32_t page = 0; page < FLASH_EMU_PAGE_COUNT; ++page)
+    {
+        erases += flash.erases[page];
+    }
+    printf("  %u preset saves: %u page erases, %u retries after a full queue\n", TEST_SAVES, erases, retries);
+}
+
+static void restore_all(void *context)
+{
+    flash_emu_stats flash;
+    uint32_t restored = 0;
+
+    nvmc_initialize();
+    preset_init();
+    flash_emu_get_stats(&flash, true);
+
+    for (uint32_t index = 0; index < PRESET_COUNT; ++index)
+    {
+        uint32_t n = TEST_SAVES - PRESET_COUNT + index;
+        HSB_color expected = save_color(n);
+        char expected_name[PRESET_NAME_SIZE];
+        HSB_color color;
+        const char *name;
+
+        save_name(n, expected_name);
+        if (preset_get(index, &color, &name) && memcmp(&color, &expected, sizeof(color)) == 0 &&
+            strcmp(name, expected_name) == 0)
+        {
+            restored++;
+        }
+
+        CHECK(preset_recall(index));
+        CHECK(memcmp(&current, &expected, sizeof(current)) == 0);
+    }
+
+    flash_emu_get_stats(&flash, false);
+    printf("  after reboot: %u of %u presets restored, %llu flash words read by recall\n", restored,
+           PRESET_COUNT, (unsigned long long)flash.words_read);
+
+    CHECK(restored == PRESET_COUNT);
+    CHECK(flash.words_read == 0);
+}
+
+int main(int argc, char **argv)
+{
+    flash_emu_open(argc > 1 ? argv[1] : "test_preset_bank.flash");
+    flash_emu_format();
+
+    CHECK(host_boot(save_all, NULL) == 0);
+    CHECK(host_boot(restore_all, NULL) == 0);
+
+    return host_test_result("test_preset_bank");
+}